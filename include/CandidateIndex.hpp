@@ -0,0 +1,122 @@
+#ifndef _CANDIDATE_INDEX_HPP
+#define _CANDIDATE_INDEX_HPP
+
+#include <vector>
+#include <string>
+#include <functional>
+#include "Hypergraph.hpp"
+#include "CompactHypergraph.hpp"
+
+/*
+    The candidate index is a read-only index of a data graph which speeds up the candidate generation of pattern matching.
+
+    Hypergraph::defaultMatchFunc scans all hedges for the label of a query hedge and filters them by degree afterwards.
+    Instead, the index groups the hedges by (label, indegree bucket, outdegree bucket), where a bucket covers the degrees 2^(b-1) ... 2^b - 1.
+    A query hedge only visits the buckets of its label which can hold large enough degrees and checks the exact degrees
+    in the lowest buckets only.
+
+    The remaining candidates are pruned by neighbourhood label frequency (NLF) signatures:
+    A match maps the next (previous) neighbours of a query hedge to distinct next (previous) neighbours of its image.
+    So for every label, a candidate needs at least as many next (previous) neighbours with that label as the query hedge.
+    NOTE: Query neighbours with an empty label or an id found in the data graph match without regard to their label and are not counted.
+
+    Property constraints (e.g. age > 40) of the query hedges are pushed down into the candidate generation:
+    For the property keys given at construction, the index keeps a secondary index ordering all hedges by value.
+    The most selective indexed constraint of a query hedge yields its candidates directly (without visiting all hedges of its label),
+    all other constraints are checked for each candidate. So the search never extends a partial match by a hedge violating a constraint.
+
+    The same index can be used for any number of queries (see matchFunc).
+    NOTE: Changes of the data graph are NOT reflected. Create a new index instead.
+*/
+
+/*
+    A declarative constraint on a property of a query hedge, e.g. "age > 40" or "name == Alice" or "age" (the property exists).
+    Values which can be read as a number are compared as numbers, all others as strings.
+    Numbers and strings are never equal and cannot be ordered (so "age < 40" fails for age "unknown").
+    A hedge without the property violates every constraint on it.
+*/
+struct PropertyConstraint
+{
+    enum Operator { EXISTS, EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL };
+
+    std::string key;
+    Operator op;
+    std::string value;
+
+    bool matches(const Hyperedge& hedge) const;
+    // Parses <key> [<op> <value>] with op one of == (or =), !=, <, <=, >, >=. Returns false if the key is missing.
+    static bool parse(const std::string& expression, PropertyConstraint& result);
+};
+using PropertyConstraints = std::unordered_map< UniqueId, std::vector< PropertyConstraint > >;
+// Collects the constraints stored in the properties of the query hedges. Multiple constraints are separated by ';', e.g. where: "age > 40; name"
+PropertyConstraints propertyConstraintsOf(const Hypergraph& query, const std::string& key="where");
+
+class CandidateIndex
+{
+    public:
+        CandidateIndex(const Hypergraph& data, const std::vector< std::string >& indexedKeys=std::vector< std::string >());
+
+        // Returns the candidates of the hedge queryId of the query graph (ordered by id).
+        // Like defaultMatchFunc, a hedge whose id exists in the data graph can only be matched to itself.
+        Hyperedges candidates(const Hypergraph& query, const UniqueId& queryId) const;
+        // Same as above, but only the hedges fulfilling all constraints are returned (data has to be the indexed graph)
+        Hyperedges candidates(const Hypergraph& data, const Hypergraph& query, const UniqueId& queryId, const std::vector< PropertyConstraint >& constraints) const;
+
+        // A MatchFunc using this index (see Hypergraph::match). The data graph passed by the matcher has to be the indexed one.
+        // NOTE: Index and query graph are referenced, so they have to outlive the MatchFunc.
+        struct MatchFunc
+        {
+            const CandidateIndex& index;
+            const Hypergraph& query;
+            const PropertyConstraints* constraints;
+
+            Hyperedges operator()(const Hypergraph& data, const Hyperedge& queryHedge) const;
+        };
+        MatchFunc matchFunc(const Hypergraph& query) const { return MatchFunc{*this, query, nullptr}; }
+        MatchFunc matchFunc(const Hypergraph& query, const PropertyConstraints& constraints) const { return MatchFunc{*this, query, &constraints}; }
+
+        const CompactHypergraph& data() const { return _data; }
+        static unsigned bucket(const unsigned degree);              // 0 for degree 0, floor(log2(degree)) + 1 otherwise
+        bool indexed(const std::string& key) const { return _properties.count(key) > 0; }
+
+    protected:
+        // A signature is a list of (label number, count) pairs ordered by label number
+        using Signature = std::vector< std::pair< unsigned, unsigned > >;
+
+        struct Bucket
+        {
+            unsigned in;
+            unsigned out;
+            std::vector< Handle > hedges;
+        };
+
+        // A property value as ordered by the secondary indexes: All numbers (by value) before all strings
+        struct Value
+        {
+            bool text;
+            double number;
+            std::string string;
+
+            Value(const std::string& value="");
+            bool operator< (const Value& other) const;
+        };
+        using PropertyIndex = std::vector< std::pair< Value, Handle > >;   // ordered by value
+
+        // Returns the candidates out of driver (or the buckets if driver is null) which fulfill the filter (if given)
+        Hyperedges collect(const Hypergraph& query, const UniqueId& queryId, const std::vector< Handle >* driver, const std::function< bool (const Handle) >& filter) const;
+        bool covers(const Handle h, const Signature& next, const Signature& previous) const;
+        Signature signatureOf(const Hypergraph& query, const Hyperedges& neighbours) const;
+
+        const CompactHypergraph _data;
+        std::vector< unsigned > _indegrees;
+        std::vector< unsigned > _outdegrees;
+        std::vector< std::vector< Bucket > > _buckets;              // Buckets of every label number ordered by (in, out)
+        // NLF signatures in CSR format: The signature of h is stored at [offsets[h], offsets[h+1])
+        std::vector< unsigned > _nextOffsets;
+        Signature _nextSignatures;
+        std::vector< unsigned > _prevOffsets;
+        Signature _prevSignatures;
+        std::unordered_map< std::string, PropertyIndex > _properties;     // secondary indexes keyed by property key
+};
+
+#endif
@@ -2,6 +2,8 @@
 #define _COMMON_CONCEPTGRAPH_HPP
 
 #include "Conceptgraph.hpp"
+#include <mutex>
+#include <memory>
 
 /*
 * This concept graph introduces the well known concepts of subsumption, composition etc.
@@ -49,6 +51,23 @@
 * 
 */
 
+/*
+* Compile-time tags for the predefined relations (see the typed queries of CommonConceptGraph)
+* Each tag provides the UniqueId of its relation via id() and a fixed slot of the cache holding the resolved relation
+* (the relation and all its subrelations) of every graph. So a typed query resolves its relation once per state of the graph (see Hypergraph::version).
+*/
+struct Rel
+{
+    static const unsigned slots = 7;
+    struct FactOf;
+    struct SubrelOf;
+    struct IsA;
+    struct HasA;
+    struct PartOf;
+    struct Connects;
+    struct InstanceOf;
+};
+
 class CommonConceptGraph : public Conceptgraph
 {
     public:
@@ -97,10 +116,26 @@ class CommonConceptGraph : public Conceptgraph
         Hyperedges subrelationsOf(const UniqueId superRelId, const std::string& label="", const TraversalDirection dir=INVERSE) const;    //transitive subrelOf
         Hyperedges subrelationsOf(const Hyperedges& superRelIds, const std::string& label="", const TraversalDirection dir=INVERSE) const;    //transitive subrelOf
         Hyperedges directSubrelationsOf(const Hyperedges& superRelIds, const std::string& label="", const TraversalDirection dir=INVERSE) const;    //non-transitive subrelOf
+        Hyperedges transitiveFactsOf(const Hyperedges& relationUids) const;     // all facts of relationUids and their subrelations (one pass over all FACT-OF hedges)
+        Hypergraph factGraphOf(const Hyperedges& relationUids) const;          // graph in which a points to b for every fact a <- R -> b of transitiveFactsOf(relationUids)
 
         /*General queries using common queries*/
         Hyperedges relatedTo(const Hyperedges& conceptUids, const Hyperedges& relationUids, const std::string& label="", const TraversalDirection dir=FORWARD) const; // non-transitive
         Hyperedges transitivelyRelatedTo(const Hyperedges& conceptUids, const Hyperedges& relationUids, const std::string& label="", const TraversalDirection dir=FORWARD) const; // transitive
+        HyperedgeLists transitivelyRelatedToEach(const Hyperedges& conceptUids, const Hyperedges& relationUids, const std::string& label="", const TraversalDirection dir=FORWARD) const; // transitive, one list per concept
+
+        /*Typed queries using a compile-time relation tag R (e.g. relatedTo<Rel::IsA>(ids))*/
+        // These only look at the relations attached to the visited hedges (no scans over all facts or relations)
+        template< typename R > Hyperedges relatedTo(const Hyperedges& conceptUids, const std::string& label="", const TraversalDirection dir=FORWARD) const; // non-transitive
+        template< typename R > Hyperedges transitivelyRelatedTo(const Hyperedges& conceptUids, const std::string& label="", const TraversalDirection dir=FORWARD) const; // transitive
+        template< typename R > bool isFactOf(const UniqueId& factUid) const;    // true if factUid is a fact of R (or one of its subrelations)
+
+        /*Ordering*/
+        // Returns the levels of a topological order over all facts of relationUids (and their subrelations) found in one pass over the FACT-OF hedges.
+        // FORWARD: the hedges a fact points from come first (e.g. subclasses before superclasses, parts before wholes). INVERSE: the other way around.
+        // The hedges of a level do not depend on each other, so a level can be processed in parallel once all previous levels are done.
+        // Hedges which are part of or depend on a cycle can not be ordered and are returned in cyclicUids instead.
+        HyperedgeLists topologicalOrderOf(const Hyperedges& relationUids, Hyperedges& cyclicUids, const TraversalDirection dir=FORWARD) const;
 
         /*Derived queries using either relatedTo or transitivelyRelatedTo*/
         /*NOTE: The traversal direction tells if the basic relation is to be followed in its direction(FORWARD) or against it(INVERSE)*/
@@ -145,8 +180,38 @@ class CommonConceptGraph : public Conceptgraph
         // The matchFunc m should return the potential costs, whenever two concepts shall be matched. The signature is float (CommonConceptGraph&, UniqueId, UniqueId)
         // The mapFunc mp should map the two concepts and update the corresponding resources. The signature is void (CommonConceptGraph&, UniqueId, UniqueId)
         template<typename PartitionFuncLeft, typename PartitionFuncRight,  typename MatchFunc, typename MapFunc > CommonConceptGraph map (PartitionFuncLeft pl, PartitionFuncRight pr, MatchFunc m, MapFunc mp) const;
+
+    protected:
+        /*Local helpers of the typed queries*/
+        using RelationSet = std::unordered_set< UniqueId >;
+        // The resolved relations of the tags together with the version of the graph they have been resolved for.
+        // NOTE: Copies start with an empty cache. The mutex allows concurrent typed queries on the same graph.
+        struct RelationCache
+        {
+            std::mutex mutex;
+            unsigned long long versions[Rel::slots];
+            std::shared_ptr< const RelationSet > sets[Rel::slots];
+
+            RelationCache() : versions() {}
+            RelationCache(const RelationCache&) : versions() {}
+            RelationCache& operator= (const RelationCache&) { return *this; }
+        };
+        template< typename R > std::shared_ptr< const RelationSet > relationsOf() const;                         // R and its subrelations (cached, see RelationCache)
+        RelationSet localSubrelationsOf(const UniqueId& superRelUid) const;                                     // transitive subrelOf (including superRelUid) following only local links
+        bool isFactOfAny(const UniqueId& factUid, const RelationSet& superRelUids) const;                        // true if factUid <- FACT-OF -> one of superRelUids
+        Hyperedges relatedVia(const Hyperedges& conceptUids, const RelationSet& superRelUids, const std::string& label, const TraversalDirection dir) const;
+
+        mutable RelationCache _relations;
 };
 
+struct Rel::FactOf { static const UniqueId& id() { return CommonConceptGraph::FactOfId; } static const unsigned slot = 0; };
+struct Rel::SubrelOf { static const UniqueId& id() { return CommonConceptGraph::SubrelOfId; } static const unsigned slot = 1; };
+struct Rel::IsA { static const UniqueId& id() { return CommonConceptGraph::IsAId; } static const unsigned slot = 2; };
+struct Rel::HasA { static const UniqueId& id() { return CommonConceptGraph::HasAId; } static const unsigned slot = 3; };
+struct Rel::PartOf { static const UniqueId& id() { return CommonConceptGraph::PartOfId; } static const unsigned slot = 4; };
+struct Rel::Connects { static const UniqueId& id() { return CommonConceptGraph::ConnectsId; } static const unsigned slot = 5; };
+struct Rel::InstanceOf { static const UniqueId& id() { return CommonConceptGraph::InstanceOfId; } static const unsigned slot = 6; };
+
 // Include template member functions
 // See http://stackoverflow.com/questions/495021/why-can-templates-only-be-implemented-in-the-header-file
 #include "CommonConceptGraph.tpp"
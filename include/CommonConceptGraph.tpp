@@ -77,3 +77,58 @@ template<typename PartitionFuncLeft, typename PartitionFuncRight,  typename Matc
 
     return result;
 }
+
+template< typename R > std::shared_ptr< const CommonConceptGraph::RelationSet > CommonConceptGraph::relationsOf() const
+{
+    // The slot of the tag is known at compile time, so we only have to check if the graph changed since the relation has been resolved
+    std::lock_guard< std::mutex > lock(_relations.mutex);
+    std::shared_ptr< const RelationSet >& resolved(_relations.sets[R::slot]);
+    if (!resolved || (_relations.versions[R::slot] != version()))
+    {
+        resolved = std::make_shared< const RelationSet >(localSubrelationsOf(R::id()));
+        _relations.versions[R::slot] = version();
+    }
+    return resolved;
+}
+
+template< typename R > bool CommonConceptGraph::isFactOf(const UniqueId& factUid) const
+{
+    return isFactOfAny(factUid, *relationsOf<R>());
+}
+
+template< typename R > Hyperedges CommonConceptGraph::relatedTo(const Hyperedges& conceptUids, const std::string& label, const TraversalDirection dir) const
+{
+    // The relation is known, we only have to collect its subrelations (if any)
+    return relatedVia(conceptUids, *relationsOf<R>(), label, dir);
+}
+
+template< typename R > Hyperedges CommonConceptGraph::transitivelyRelatedTo(const Hyperedges& conceptUids, const std::string& label, const TraversalDirection dir) const
+{
+    // Level-wise BFS where each level is one (non-transitive) step along the facts of R
+    const std::shared_ptr< const RelationSet > resolved(relationsOf<R>());
+    const RelationSet& superRelUids(*resolved);
+    Hyperedges result;
+    std::set< UniqueId > visited;
+    Hyperedges frontier;
+    for (const UniqueId& uid : conceptUids)
+    {
+        if (visited.insert(uid).second)
+            frontier.push_back(uid);
+    }
+    while (!frontier.empty())
+    {
+        for (const UniqueId& uid : frontier)
+        {
+            if (label.empty() || (access(uid).label() == label))
+                result.push_back(uid);
+        }
+        Hyperedges next;
+        for (const UniqueId& uid : relatedVia(frontier, superRelUids, "", dir))
+        {
+            if (visited.insert(uid).second)
+                next.push_back(uid);
+        }
+        frontier.swap(next);
+    }
+    return result;
+}
@@ -0,0 +1,144 @@
+#ifndef _COMPACT_HYPERGRAPH_HPP
+#define _COMPACT_HYPERGRAPH_HPP
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include "Hypergraph.hpp"
+#include "SparseMatrix.hpp"
+
+/*
+    The compact hypergraph is a frozen, read-only snapshot of a hypergraph.
+
+    Every hyperedge gets a dense handle 0 ... size()-1 (in the order of the sorted UniqueIds, so handles are reproducible)
+    and all adjacency information is stored in CSR arrays of handles:
+    * pointingTo/pointingFrom are the rows of the incidence matrix (see Hyperedge) translated to handles
+    * next/previous/neighbours are the (duplicate free) neighbourhoods as defined by Hypergraph::nextNeighboursOf/previousNeighboursOf/allNeighboursOf
+
+    This allows graph algorithms to use plain arrays & bitmaps keyed by handle instead of hashing UniqueIds.
+    NOTE: Changes of the original hypergraph are NOT reflected. Create a new snapshot instead.
+*/
+
+// A read-only view on a row of handles of a CSR array
+struct HandleRange
+{
+    const Handle* first;
+    const Handle* last;
+
+    const Handle* begin() const { return first; }
+    const Handle* end() const { return last; }
+    unsigned size() const { return last - first; }
+    bool empty() const { return first == last; }
+};
+
+class CompactHypergraph
+{
+    public:
+        static const Handle Invalid;                                    // Returned if a UniqueId is not part of the snapshot
+
+        CompactHypergraph(const Hypergraph& graph);
+
+        /*Handles*/
+        unsigned size() const { return _ids.size(); }
+        Handle handle(const UniqueId& id) const;                        // Returns the handle of id or Invalid
+        const UniqueId& id(const Handle h) const { return _ids[h]; }
+        const Hyperedges& ids() const { return _ids; }                  // All ids ordered by handle
+        Hyperedges ids(const std::vector< Handle >& handles) const;     // Translates handles back to ids
+        std::vector< Handle > handles(const Hyperedges& ids) const;     // Translates ids to handles (unknown ids are skipped)
+
+        /*Labels are stored as dense label numbers*/
+        unsigned label(const Handle h) const { return _labels[h]; }
+        unsigned labelCount() const { return _labelNames.size(); }
+        const std::string& labelName(const unsigned l) const { return _labelNames[l]; }
+        unsigned labelOf(const std::string& name) const;                // Returns the label number of name or Invalid
+
+        /*Adjacency*/
+        HandleRange pointingTo(const Handle h) const { return row(_toOffsets, _to, h); }
+        HandleRange pointingFrom(const Handle h) const { return row(_fromOffsets, _from, h); }
+        HandleRange next(const Handle h) const { return row(_nextOffsets, _next, h); }          // sorted, no duplicates
+        HandleRange previous(const Handle h) const { return row(_prevOffsets, _prev, h); }      // sorted, no duplicates
+        HandleRange neighbours(const Handle h) const { return row(_allOffsets, _all, h); }     // next & previous (sorted, no duplicates)
+
+        /*Sparse matrix export*/
+        enum MatrixType {
+            POINTING_TO,    // M[a][b] = how often a points to b
+            POINTING_FROM,  // M[a][b] = how often a points from b
+            NEXT            // M[a][b] = 1 iff b is one of the next neighbours of a (so multiplying a frontier by M moves it FORWARD)
+        };
+        SparseMatrix csr(const MatrixType type=NEXT) const;         // compressed sparse rows
+        SparseMatrix csc(const MatrixType type=NEXT) const;         // compressed sparse columns (stored as CSR of the transpose)
+        CoordinateMatrix coo(const MatrixType type=NEXT) const;     // coordinate format
+
+        /*Motif counting*/
+        // Counts the triangles of the undirected graph given by neighbours() (self loops are ignored) using degree ordering & sorted intersections.
+        // Returns the global count. perHedge receives the number of triangles each hedge is part of.
+        unsigned long long triangles(std::vector< unsigned >& perHedge, const unsigned threads=0) const;
+        // Counts the pairs of distinct successors (FORWARD, e.g. two children sharing a parent) or predecessors (INVERSE) of every hedge.
+        // Returns the global count. perHedge receives the count of every hedge.
+        unsigned long long wedges(std::vector< unsigned long long >& perHedge, const Hypergraph::TraversalDirection dir=Hypergraph::FORWARD) const;
+
+        /*Sampling*/
+        // All samplers use their own seeded generator, so the same seed gives the same sample (on the same snapshot).
+        // They stop as soon as count distinct hedges have been sampled (or nothing more can be reached).
+        std::vector< Handle > uniformSample(const unsigned count, const unsigned seed=0) const;
+        // Random walk over the neighbourhood given by dir which jumps back to one of the starts with the given probability (or when stuck)
+        std::vector< Handle > randomWalkSample(const std::vector< Handle >& starts, const unsigned count, const double restart=0.15,
+                                               const Hypergraph::TraversalDirection dir=Hypergraph::BOTH, const unsigned seed=0) const;
+        // Forest fire: Burns a geometrically distributed number (mean burn / (1 - burn)) of unburnt neighbours of every burning hedge
+        // With burn >= 1, all unburnt neighbours get burnt (breadth first)
+        std::vector< Handle > forestFireSample(const unsigned count, const double burn=0.7, const unsigned seed=0) const;
+
+        /*Projections*/
+        // The members of a hedge are the hedges it points from and to. This makes every hedge a hyperedge over its members.
+        // The bipartite (incidence) graph: M[h][m] = how often m is a member of h
+        SparseMatrix bipartite() const;
+        // The clique expansion (2-section): A[a][b] != 0 iff a != b are members of a common hedge.
+        // If weighted, A[a][b] is the number of such common hedges, otherwise it is 1.
+        SparseMatrix cliqueExpansion(const bool weighted=true) const;
+        // Streaming variant of cliqueExpansion: Calls f(a, b, weight) for every entry row by row without storing the projection.
+        // Only O(size()) temporary memory is needed besides the bipartite graph.
+        template< typename EdgeFunc > void cliqueExpansion(EdgeFunc f, const bool weighted=true) const;
+
+        /*Connected components*/
+        // All methods return a component number per handle. Components are numbered 0,1,... in the order of their smallest handle
+        std::vector< unsigned > weaklyConnectedComponents() const;                          // union-find over all (undirected) adjacencies
+        std::vector< unsigned > stronglyConnectedComponents() const;                        // iterative Tarjan following next()
+        std::vector< unsigned > labelPropagationComponents(const unsigned threads=0) const; // parallel min-label propagation (same result as WCC)
+        HyperedgeLists groups(const std::vector< unsigned >& componentOf) const;            // Collects the ids of each component
+
+        /*Analytics*/
+        // Returns the number of hedges per degree (FORWARD: |next|, INVERSE: |previous|, BOTH: |neighbours|)
+        std::vector< unsigned > degreeHistogram(const Hypergraph::TraversalDirection dir=Hypergraph::BOTH, const unsigned threads=0) const;
+        // Returns the PageRank of each hedge following next(). Iterates until the L1 change drops below tolerance or maxIterations is reached.
+        std::vector< double > pageRank(const double damping=0.85, const unsigned maxIterations=100, const double tolerance=1e-9, const unsigned threads=0) const;
+        // Returns the core number of each hedge, i.e. the largest k such that the hedge is part of the k-core of the undirected graph (self loops are ignored)
+        std::vector< unsigned > coreNumbers() const;
+
+    protected:
+        static HandleRange row(const std::vector< unsigned >& offsets, const std::vector< Handle >& values, const Handle h)
+        {
+            return HandleRange{values.data() + offsets[h], values.data() + offsets[h+1]};
+        }
+
+        Hyperedges _ids;
+        std::unordered_map< UniqueId, Handle > _handles;
+        std::vector< unsigned > _labels;
+        std::vector< std::string > _labelNames;
+        std::unordered_map< std::string, unsigned > _labelNumbers;
+
+        std::vector< unsigned > _toOffsets;
+        std::vector< Handle > _to;
+        std::vector< unsigned > _fromOffsets;
+        std::vector< Handle > _from;
+        std::vector< unsigned > _nextOffsets;
+        std::vector< Handle > _next;
+        std::vector< unsigned > _prevOffsets;
+        std::vector< Handle > _prev;
+        std::vector< unsigned > _allOffsets;
+        std::vector< Handle > _all;
+};
+
+// Include template member functions
+#include "CompactHypergraph.tpp"
+
+#endif
@@ -0,0 +1,37 @@
+// This file holds all templated member functions
+#include <vector>
+#include <algorithm>
+
+template< typename EdgeFunc > void CompactHypergraph::cliqueExpansion(EdgeFunc f, const bool weighted) const
+{
+    // For every member a we visit all hedges containing it and accumulate their other members in a dense array (sparse accumulator)
+    const SparseMatrix& membersOf(bipartite());
+    const SparseMatrix& containing(membersOf.transposed());
+    const unsigned n(size());
+    std::vector< unsigned > weight(n, 0);
+    std::vector< Handle > touched;
+    for (Handle a = 0; a < n; a++)
+    {
+        for (unsigned i = containing.offsets[a]; i < containing.offsets[a + 1]; i++)
+        {
+            const Handle h(containing.indices[i]);
+            for (unsigned j = membersOf.offsets[h]; j < membersOf.offsets[h + 1]; j++)
+            {
+                const Handle b(membersOf.indices[j]);
+                if (b == a)
+                    continue;
+                if (!weight[b])
+                    touched.push_back(b);
+                weight[b]++;
+            }
+        }
+        // Emit the row in order and reset the accumulator
+        std::sort(touched.begin(), touched.end());
+        for (const Handle b : touched)
+        {
+            f(a, b, weighted ? weight[b] : 1u);
+            weight[b] = 0;
+        }
+        touched.clear();
+    }
+}
@@ -67,6 +67,27 @@ class Conceptgraph : public Hypergraph
                             ConceptFilterFunc cf,                                   //< visiting a concept OR relation this function should either return true or false.
                             RelationFilterFunc rf,                                  //< decide whether to follow a relation or not.
                             const TraversalDirection dir=FORWARD) const;
+        // Multi-source traversal: All roots share ONE visited set, so overlapping (sub)graphs are only walked once
+        template< typename ConceptFilterFunc, typename RelationFilterFunc > Hyperedges traverse(
+                            const Hyperedges& rootIds,                              //< Traverse the (sub)graph(s) starting at any of rootIds
+                            ConceptFilterFunc cf,
+                            RelationFilterFunc rf,
+                            const TraversalDirection dir=FORWARD) const;
+        // Multi-source traversal with one result list per root (the i-th list holds the hedges reachable from rootIds[i])
+        // The roots are processed in batches of 64 which share a single sweep (bit-parallel BFS).
+        // NOTE: Paths are not tracked per root, so the ConceptFilterFunc gets only the current hedge as path
+        template< typename ConceptFilterFunc, typename RelationFilterFunc > HyperedgeLists traverseEach(
+                            const Hyperedges& rootIds,
+                            ConceptFilterFunc cf,
+                            RelationFilterFunc rf,
+                            const TraversalDirection dir=FORWARD) const;
+
+    protected:
+        // Returns all hedges reachable from currentId via a single relation accepted by rf (duplicates are possible)
+        template< typename RelationFilterFunc > Hyperedges neighboursVia(
+                            const UniqueId& currentId,
+                            RelationFilterFunc rf,
+                            const TraversalDirection dir) const;
 };
 
 #include "Conceptgraph.tpp"
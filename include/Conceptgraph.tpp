@@ -1,11 +1,77 @@
 #include <set>
 #include <queue>
+#include <unordered_map>
+#include <cstdint>
+#include <algorithm>
+
+template< typename RelationFilterFunc > Hyperedges Conceptgraph::neighboursVia(
+                    const UniqueId& currentUid,
+                    RelationFilterFunc rf,
+                    const TraversalDirection dir) const
+{
+    Hyperedges result;
+    // Get the relations of currentUid depending on dir
+    switch (dir)
+    {
+        case FORWARD:
+            {
+                const Hyperedges& relations(relationsFrom(Hyperedges{currentUid}));
+                for (const UniqueId& relUid : relations)
+                {
+                    // If RelationFilterFunc returns true, we collect all targets of it
+                    if (rf(*this, currentUid, relUid))
+                    {
+                        const Hyperedges& others(access(relUid).pointingTo());
+                        result.insert(result.end(), others.begin(), others.end());
+                    }
+                }
+            }
+            break;
+        case BOTH:
+            {
+                const Hyperedges& relations(relationsFrom(Hyperedges{currentUid}));
+                for (const UniqueId& relUid : relations)
+                {
+                    // If RelationFilterFunc returns true, we collect all targets of it
+                    if (rf(*this, currentUid, relUid))
+                    {
+                        const Hyperedges& others(access(relUid).pointingTo());
+                        result.insert(result.end(), others.begin(), others.end());
+                    }
+                }
+            }
+        case INVERSE:
+            {
+                const Hyperedges& relations(relationsTo(Hyperedges{currentUid}));
+                for (const UniqueId& relUid : relations)
+                {
+                    // If RelationFilterFunc returns true, we collect all sources of it
+                    if (rf(*this, currentUid, relUid))
+                    {
+                        const Hyperedges& others(access(relUid).pointingFrom());
+                        result.insert(result.end(), others.begin(), others.end());
+                    }
+                }
+            }
+            break;
+    }
+    return result;
+}
 
 template< typename ConceptFilterFunc, typename RelationFilterFunc > Hyperedges Conceptgraph::traverse(
                     const UniqueId& rootId,
                     ConceptFilterFunc cf,
                     RelationFilterFunc rf,
                     const TraversalDirection dir) const
+{
+    return traverse(Hyperedges{rootId}, cf, rf, dir);
+}
+
+template< typename ConceptFilterFunc, typename RelationFilterFunc > Hyperedges Conceptgraph::traverse(
+                    const Hyperedges& rootIds,
+                    ConceptFilterFunc cf,
+                    RelationFilterFunc rf,
+                    const TraversalDirection dir) const
 {
     // NOTE: We cannot use Hypergraph::traverse here, because concepts do not point to neighbouring relations (yet?)
     // That means, that we have C <-R-> C and not C-> R-> C
@@ -14,8 +80,12 @@ template< typename ConceptFilterFunc, typename RelationFilterFunc > Hyperedges C
     std::queue< UniqueId > toVisit;
     std::queue< Hyperedges > path;
 
-    toVisit.push(rootId);
-    path.push(Hyperedges{rootId});
+    // All roots are enqueued at once, so they share the visited set
+    for (const UniqueId& rootId : rootIds)
+    {
+        toVisit.push(rootId);
+        path.push(Hyperedges{rootId});
+    }
 
     // Run through queue of unknown edges
     while (!toVisit.empty())
@@ -38,64 +108,99 @@ template< typename ConceptFilterFunc, typename RelationFilterFunc > Hyperedges C
             result.push_back(currentUid);
         }
 
-        // Get the relations of currentUid depending on dir
-        switch (dir)
+        // Push all hedges reachable via accepted relations to the toVisit queue
+        for (const UniqueId& otherUid : neighboursVia(currentUid, rf, dir))
         {
-            case FORWARD:
-                {
-                    const Hyperedges& relations(relationsFrom(Hyperedges{currentUid}));
-                    for (const UniqueId& relUid : relations)
-                    {
-                        // If RelationFilterFunc returns true, we push all targets of it to the toVisit queue
-                        if (rf(*this, currentUid, relUid))
-                        {
-                            for (const UniqueId& otherUid : access(relUid).pointingTo())
-                            {
-                                currentPath.push_back(otherUid);
-                                path.push(currentPath);
-                                toVisit.push(otherUid);
-                            }
-                        }
-                    }
-                }
-                break;
-            case BOTH:
-                {
-                    const Hyperedges& relations(relationsFrom(Hyperedges{currentUid}));
-                    for (const UniqueId& relUid : relations)
-                    {
-                        // If RelationFilterFunc returns true, we push all targets of it to the toVisit queue
-                        if (rf(*this, currentUid, relUid))
-                        {
-                            for (const UniqueId& otherUid : access(relUid).pointingTo())
-                            {
-                                currentPath.push_back(otherUid);
-                                path.push(currentPath);
-                                toVisit.push(otherUid);
-                            }
-                        }
-                    }
-                }
-            case INVERSE:
+            if (visited.count(otherUid))
+                continue;
+            currentPath.push_back(otherUid);
+            path.push(currentPath);
+            toVisit.push(otherUid);
+        }
+    }
+
+    return result;
+}
+
+template< typename ConceptFilterFunc, typename RelationFilterFunc > HyperedgeLists Conceptgraph::traverseEach(
+                    const Hyperedges& rootIds,
+                    ConceptFilterFunc cf,
+                    RelationFilterFunc rf,
+                    const TraversalDirection dir) const
+{
+    // Each root gets one bit in a 64 bit mask. A hedge stores the roots which have reached it (seen)
+    // and the frontier stores the roots which reached a hedge in the last step.
+    // This way, the neighbourhood of a hedge is computed only once per level for up to 64 roots.
+    using RootMask = std::uint64_t;
+    const unsigned batchSize(64);
+    std::vector< Hyperedges > perRoot(rootIds.size());
+    std::unordered_map< UniqueId, bool > accepted;
+
+    for (unsigned batchStart = 0; batchStart < rootIds.size(); batchStart += batchSize)
+    {
+        const unsigned batchEnd(std::min<unsigned>(batchStart + batchSize, rootIds.size()));
+        std::unordered_map< UniqueId, RootMask > seen;
+        std::vector< std::pair< UniqueId, RootMask > > discovered;
+        std::vector< std::pair< UniqueId, RootMask > > frontier;
+
+        for (unsigned i = batchStart; i < batchEnd; i++)
+        {
+            const RootMask bit(RootMask(1) << (i - batchStart));
+            RootMask& mask(seen[rootIds[i]]);
+            if (mask & bit)
+                continue;
+            mask |= bit;
+            discovered.push_back({rootIds[i], bit});
+            frontier.push_back({rootIds[i], bit});
+        }
+
+        // Level synchronous sweep
+        while (!frontier.empty())
+        {
+            std::vector< std::pair< UniqueId, RootMask > > next;
+            std::unordered_map< UniqueId, unsigned > nextIndex;
+            for (const auto& current : frontier)
+            {
+                for (const UniqueId& otherUid : neighboursVia(current.first, rf, dir))
                 {
-                    const Hyperedges& relations(relationsTo(Hyperedges{currentUid}));
-                    for (const UniqueId& relUid : relations)
+                    RootMask& mask(seen[otherUid]);
+                    const RootMask newBits(current.second & ~mask);
+                    if (!newBits)
+                        continue;
+                    mask |= newBits;
+                    discovered.push_back({otherUid, newBits});
+                    // Merge the bits of hedges reached multiple times on this level
+                    auto it(nextIndex.find(otherUid));
+                    if (it != nextIndex.end())
                     {
-                        // If RelationFilterFunc returns true, we push all sources of it to the toVisit queue
-                        if (rf(*this, currentUid, relUid))
-                        {
-                            for (const UniqueId& otherUid : access(relUid).pointingFrom())
-                            {
-                                currentPath.push_back(otherUid);
-                                path.push(currentPath);
-                                toVisit.push(otherUid);
-                            }
-                        }
+                        next[it->second].second |= newBits;
+                    } else {
+                        nextIndex[otherUid] = next.size();
+                        next.push_back({otherUid, newBits});
                     }
                 }
-                break;
+            }
+            frontier.swap(next);
+        }
+
+        // Distribute the discovered hedges (in BFS order) to their roots
+        for (const auto& pair : discovered)
+        {
+            auto it(accepted.find(pair.first));
+            if (it == accepted.end())
+                it = accepted.insert({pair.first, cf(*this, pair.first, Hyperedges{pair.first})}).first;
+            if (!it->second)
+                continue;
+            for (unsigned i = batchStart; i < batchEnd; i++)
+            {
+                if (pair.second & (RootMask(1) << (i - batchStart)))
+                    perRoot[i].push_back(pair.first);
+            }
         }
     }
 
+    HyperedgeLists result;
+    for (const Hyperedges& reachable : perRoot)
+        result.append(reachable);
     return result;
 }
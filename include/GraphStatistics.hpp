@@ -0,0 +1,52 @@
+#ifndef _GRAPH_STATISTICS_HPP
+#define _GRAPH_STATISTICS_HPP
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "Hypergraph.hpp"
+
+/*
+    Statistics of a data graph used to plan pattern matching (see CompiledPattern):
+    * label cardinalities
+    * degree histograms per label (degrees as defined by nextNeighboursOf/previousNeighboursOf/allNeighboursOf)
+    * co-occurrences of label pairs along edges, i.e. the number of pairs (a,b) where b is one of the next neighbours of a
+
+    All of them are collected in a single pass over a snapshot of the data graph.
+    An empty label stands for all labels.
+    NOTE: Changes of the data graph are NOT reflected. Collect new statistics instead.
+*/
+
+class GraphStatistics
+{
+    public:
+        GraphStatistics(const Hypergraph& data);
+
+        unsigned size() const { return _size; }                                             // Number of hedges
+        bool contains(const UniqueId& id) const { return _ids.count(id) > 0; }
+        unsigned cardinality(const std::string& label="") const;                           // Number of hedges with label
+        // Number of hedges with label per degree (FORWARD: next, INVERSE: previous, BOTH: all neighbours)
+        std::vector< unsigned > degreeHistogram(const std::string& label="", const Hypergraph::TraversalDirection dir=Hypergraph::BOTH) const;
+        unsigned long long cooccurrences(const std::string& from, const std::string& to) const;   // Number of edges between the labels
+
+        /*Estimates*/
+        // Expected number of candidates of a query hedge (as given by defaultMatchFunc)
+        double candidates(const Hypergraph& query, const UniqueId& queryId) const;
+        // Expected number of next (FORWARD) or previous (INVERSE) neighbours with label to of a hedge with label from
+        double fanout(const std::string& from, const std::string& to, const Hypergraph::TraversalDirection dir=Hypergraph::FORWARD) const;
+
+    protected:
+        unsigned labelOf(const std::string& label) const;                                  // Label number or UINT_MAX (unknown label)
+
+        unsigned _size;
+        std::unordered_set< UniqueId > _ids;
+        std::unordered_map< std::string, unsigned > _labels;
+        std::vector< unsigned > _cardinalities;                                             // per label number
+        std::vector< std::vector< unsigned > > _histograms[3];                              // per direction & label number
+        std::unordered_map< unsigned long long, unsigned long long > _cooccurrences;        // keyed by from * labelCount + to
+        std::vector< unsigned long long > _outgoing;                                        // edges starting at a label
+        std::vector< unsigned long long > _incoming;                                        // edges ending at a label
+};
+
+#endif
@@ -26,10 +26,26 @@ Hyperedges intersect(const Hyperedges& a, const Hyperedges& b);     // Intersect
 Hyperedges subtract(const Hyperedges& a, const Hyperedges& b);      // Returns all edges which are in A but not in B
 std::ostream& operator<< (std::ostream& os , const Hyperedges& val);// Streaming operator to dump out a set of hyperedge unique ids
 
+/*
+* A compact list of hyperedge lists (CSR style)
+* The i-th list consists of ids[offsets[i]] ... ids[offsets[i+1]-1]
+*/
+struct HyperedgeLists
+{
+    std::vector<unsigned> offsets;                                  // size()+1 entries, the first one is always 0
+    Hyperedges ids;                                                 // all lists stored back to back
+
+    HyperedgeLists() : offsets(1, 0) {}
+    unsigned size() const { return offsets.size() - 1; }            // Returns the number of lists
+    Hyperedges at(const unsigned i) const;                          // Returns a copy of the i-th list
+    void append(const Hyperedges& list);                            // Appends another list
+};
+
 class Hyperedge
 {
     friend class Hypergraph;
     friend class Conceptgraph;
+    friend class CommonConceptGraph;
 
     public:
         /*Constructor*/
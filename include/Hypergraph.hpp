@@ -6,6 +6,12 @@
 #include <unordered_map>
 #include <set>
 #include <stack>
+#include <climits>
+#include <unordered_set>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <initializer_list>
 #include "Hyperedge.hpp"
 
 /*
@@ -25,21 +31,113 @@
       NOTE: This will destroy ordering of serialized YAML. Therfore we use normal ordered maps for now.
 */
 
-using Mapping = std::multimap<UniqueId, UniqueId>;   //< This map stores a many-to-many mapping between hedges (IDs)
+/*
+    A mapping stores a many-to-many mapping between hedges (IDs).
+    It is a flat vector of pairs ordered by their first id. Pairs with the same first id keep their insertion order,
+    so iterating, finding and comparing behave like a std::multimap, but without a node per pair:
+    * Lookups are binary searches, appending in order is O(1) and building a mapping from a range sorts only once
+    * join merges two sorted mappings, invert sorts one flat copy and equal sorts instead of comparing all pairs with each other
+    NOTE: Inserting in the middle moves all later pairs. To build large mappings, collect the pairs first and use the range constructor.
+*/
+class Mapping
+{
+    public:
+        using value_type = std::pair< UniqueId, UniqueId >;
+        using const_iterator = std::vector< value_type >::const_iterator;
+        using iterator = const_iterator;                                    // The pairs are read-only to keep them ordered
+
+        Mapping() {}
+        Mapping(std::initializer_list< value_type > pairs) : _pairs(pairs) { order(); }
+        template< typename Iterator > Mapping(Iterator first, Iterator last) : _pairs(first, last) { order(); }
+
+        const_iterator begin() const { return _pairs.begin(); }
+        const_iterator end() const { return _pairs.end(); }
+        std::size_t size() const { return _pairs.size(); }
+        bool empty() const { return _pairs.empty(); }
+        void clear() { _pairs.clear(); }
+        void reserve(const std::size_t n) { _pairs.reserve(n); }
+
+        iterator insert(const value_type& pair);                            // Inserts after all pairs with the same first id
+        iterator erase(const_iterator position);
+        const_iterator find(const UniqueId& id) const;                      // The first pair with the given first id (or end)
+        std::size_t count(const UniqueId& id) const;
+        std::pair< const_iterator, const_iterator > equal_range(const UniqueId& id) const;
+
+        // Compares the pairs in order (see equal for a comparison ignoring the order of pairs with the same first id)
+        bool operator== (const Mapping& other) const { return _pairs == other._pairs; }
+        bool operator!= (const Mapping& other) const { return _pairs != other._pairs; }
+        bool operator< (const Mapping& other) const { return _pairs < other._pairs; }
+
+    protected:
+        void order();                                                       // Sorts the pairs by their first id (stable)
+
+        std::vector< value_type > _pairs;
+};
 bool equal(const Mapping& a, const Mapping& b);      //< Check if two mappings are equal or not
 Mapping invert(const Mapping& m);                    //< Returns the inverse mapping
 Mapping fromHyperedges(const Hyperedges& a);         //< Constructs a identity mapping between the elements of a
 Mapping join(const Mapping& a, const Mapping& b);    //< Constructs from two mappings the inner join: a:X->Y, b:X->Z --> result: Y->Z
 std::ostream& operator<< (std::ostream& os , const Mapping& val);
 
+// Hash based variant for large mappings which are mostly probed by id: O(1) inserts and lookups, but unordered
+using HashMapping = std::unordered_multimap< UniqueId, UniqueId >;
+bool equal(const HashMapping& a, const HashMapping& b);
+HashMapping invert(const HashMapping& m);
+HashMapping join(const HashMapping& a, const HashMapping& b);   //< hash join (probes b for every pair of a)
+
+class MatchState;
+class CompiledPattern;
+class CompactHypergraph;
+class GraphStatistics;
+
+// Options of Hypergraph::matchAll
+struct MatchOptions
+{
+    unsigned long long maxResults = 0;  //< Stop after this many matches (0: no limit)
+    unsigned timeBudget = 0;            //< Stop after this many milliseconds (0: no limit)
+    bool countOnly = false;             //< Only count the matches. No Mapping gets built and the sink is not called.
+    unsigned threads = 1;               //< Number of threads (0: all cores)
+    bool deterministic = false;         //< Pass the matches in the order of the sequential search (only relevant for multiple threads)
+    bool symmetryBreaking = false;      //< Find every embedding only once instead of once per automorphism of the query graph
+    bool expandSymmetries = false;      //< With symmetryBreaking: Pass all automorphic variants of an embedding (same matches as without symmetryBreaking)
+};
+
+// Result of Hypergraph::matchAll
+struct MatchSummary
+{
+    unsigned long long matches;         //< Number of matches passed to the sink (or counted)
+    bool complete;                      //< false if the search has been stopped early (by the sink, maxResults or timeBudget)
+};
+
+// An entry of the change log of a hypergraph (see Hypergraph::record)
+struct Change
+{
+    enum Kind { CREATE, POINTS_TO, POINTS_FROM, DISCONNECT, DESTROY };
+
+    Kind kind;
+    Hyperedges ids;         //< The hedge created, disconnected or destroyed or the srcIds (destIds) of pointsTo (pointsFrom)
+    Hyperedges others;      //< The others of pointsTo (pointsFrom) or the former neighbours of a disconnected hedge
+};
+using ChangeLog = std::vector< Change >;
+
 class Hypergraph {
     public:
         static const UniqueId Zero;                  // This hyperedge represents the zero element of the hypergraph formalism.
 
         Hypergraph();
         Hypergraph(const Hypergraph& other);         // copy constructor to repopulate the hyperedge cache(s)
+        Hypergraph& operator= (const Hypergraph& other);    // copies the hedges but keeps recording into the own log (if any)
         ~Hypergraph();
 
+        /*Change log*/
+        // Appends every change made by create, pointsTo, pointsFrom, disconnect and destroy to log (nullptr stops recording).
+        // NOTE: Changes made through a hedge returned by access() are NOT recorded. Copies of a graph do not record.
+        void record(ChangeLog* log) { _log = log; }
+        ChangeLog* log() const { return _log; }
+        // A stamp of the current state which changes with every recorded change (see above) and with copying.
+        // Stamps are unique over all graphs, so results derived from a graph can be cached together with its stamp.
+        unsigned long long version() const { return _version; }
+
         /*Factory functions for member edges*/
         Hyperedges create(const UniqueId id, 
                           const std::string& label="",            // Tries to create a hyperedge with a given id ... if already taken, returns empty set
@@ -83,6 +181,32 @@ class Hypergraph {
             const TraversalDirection dir = FORWARD
         ) const;
 
+        /*Bounded neighbourhood queries*/
+        // Returns all hedges within k hops of ids (ids included) in BFS order. Only hedges matching the label (if given) are visited.
+        // The caps bound the size of the answer: At most maxNodes hedges are returned and hedges with more than maxFanout neighbours
+        // (e.g. IsConceptId) are returned but not expanded.
+        Hyperedges neighbourhood(const Hyperedges& ids, const unsigned k=1, const TraversalDirection dir=BOTH, const std::string& label="",
+                                 const unsigned maxNodes=UINT_MAX, const unsigned maxFanout=UINT_MAX) const;
+        Hypergraph subgraph(const Hyperedges& ids) const;   // Returns the subgraph induced by ids (wiring to hedges outside of ids is dropped)
+
+        /*Connected components*/
+        // These return the ids of each component (see CompactHypergraph for the variants returning a component number per handle)
+        // Adjacency is defined as in nextNeighboursOf. Weak components ignore the direction.
+        HyperedgeLists weaklyConnectedComponents() const;                           // union-find
+        HyperedgeLists stronglyConnectedComponents() const;                         // iterative Tarjan
+        HyperedgeLists labelPropagationComponents(const unsigned threads=0) const;  // weak components by parallel label propagation (0 threads: use all cores)
+
+        /*Analytics (see CompactHypergraph for details and the variants working on handles)*/
+        std::vector< unsigned > degreeHistogram(const TraversalDirection dir=BOTH, const unsigned threads=0) const; // Number of hedges per degree
+        std::map< UniqueId, double > pageRank(const double damping=0.85, const unsigned threads=0) const;         // PageRank following nextNeighboursOf
+        std::map< UniqueId, unsigned > coreNumbers() const;                                                      // k-core number of every hedge
+
+        /*Sampling (see CompactHypergraph for details). Use subgraph() to materialize a sample*/
+        Hyperedges uniformSample(const unsigned count, const unsigned seed=0) const;                                          // count hedges chosen uniformly
+        Hyperedges randomWalkSample(const Hyperedges& startIds, const unsigned count, const double restart=0.15,
+                                    const TraversalDirection dir=BOTH, const unsigned seed=0) const;                        // random walk with restart
+        Hyperedges forestFireSample(const unsigned count, const double burn=0.7, const unsigned seed=0) const;               // forest fire
+
         /* Default matching function */
         // Note: here we need a reference to the queryHedge (not UniqueId) to access its label and other metrics
         static Hyperedges defaultMatchFunc(const Hypergraph& datagraph, const Hyperedge& queryHedge)
@@ -111,11 +235,59 @@ class Hypergraph {
         }
 
         /* Pattern matching */
+        enum MatchEngine {
+            ULLMANN,    // Selects the next query hedge for every state and revalidates the whole mapping (QuickSI style)
+            VF2         // Uses a precomputed match order (VF2++ style), checks only the pairs touching the new hedge and prunes by look-ahead
+        };
+        template< typename MatchFunc > Mapping match(
+                      const Hypergraph& other,                    //< The graph to be found in the current graph
+                      MatchState& state,                          //< The state of the search (see MatchState). Caches all setup work between calls.
+                      MatchFunc m                                 //< A binary function Hyperedges m(Hypergraph&, Hyperedge&)
+                     ) const;
+        // NOTE: This variant has to redo the candidate filtering on every call. Prefer the one above.
         template< typename MatchFunc > Mapping match(
                       const Hypergraph& other,                    //< The graph to be found in the current graph
                       std::stack< Mapping >& searchSpace,         //< A tree of the current state in search space.
+                      MatchFunc m,                                //< A binary function Hyperedges m(Hypergraph&, Hyperedge&)
+                      const MatchEngine engine=ULLMANN            //< The search algorithm (both find the same matches, but in different order)
+                     ) const;
+
+        /* Enumerating all matches */
+        // Streams all matches of other to the sink bool sink(const Mapping&) using the VF2 engine. If the sink returns false, the search stops.
+        // With multiple threads, the search tree is split by the candidates of the first hedge in the match order,
+        // which get distributed over the threads by work stealing (see parallelForEachTask).
+        // Calls of the sink are serialized, so it does not have to be thread safe.
+        template< typename Sink, typename MatchFunc > MatchSummary matchAll(
+                      const Hypergraph& other,                    //< The graph to be found in the current graph
+                      Sink sink,                                  //< Receives the matches
+                      const MatchOptions& options,                //< Limits, count only mode and threads
+                      MatchFunc m                                 //< A binary function Hyperedges m(Hypergraph&, Hyperedge&)
+                     ) const;
+        template< typename Sink > MatchSummary matchAll(const Hypergraph& other, Sink sink, const MatchOptions& options=MatchOptions()) const
+        {
+            return matchAll(other, sink, options, defaultMatchFunc);
+        }
+        // Variants using a compiled pattern (see CompiledPattern) instead of planning the search for every call
+        template< typename MatchFunc > Mapping match(
+                      const CompiledPattern& pattern,             //< The compiled query graph
+                      MatchState& state,                          //< The state of the search (uses the VF2 engine)
                       MatchFunc m                                 //< A binary function Hyperedges m(Hypergraph&, Hyperedge&)
                      ) const;
+        template< typename Sink, typename MatchFunc > MatchSummary matchAll(const CompiledPattern& pattern, Sink sink, const MatchOptions& options, MatchFunc m) const;
+        template< typename Sink > MatchSummary matchAll(const CompiledPattern& pattern, Sink sink, const MatchOptions& options=MatchOptions()) const
+        {
+            return matchAll(pattern, sink, options, defaultMatchFunc);
+        }
+        // Parallel variant of matchAll without limits.
+        // If deterministic, the sink gets the matches in the order of the sequential search (matches found out of order are buffered).
+        // Returns the number of matches passed to the sink.
+        template< typename MatchFunc, typename Sink > unsigned long long matchParallel(
+                      const Hypergraph& other,                    //< The graph to be found in the current graph
+                      MatchFunc m,                                //< A binary function Hyperedges m(Hypergraph&, Hyperedge&)
+                      Sink sink,                                  //< Receives the matches
+                      const unsigned threads=0,                   //< Number of threads (0: all cores)
+                      const bool deterministic=false              //< Keep the order of the sequential search
+                     ) const;
 
         /* Graph rewriting: single pushout */
         // NOTE: Partial Map means, that hedges in lhs do not need to be mapped to hedges in rhs (if not mapped, then they will get destroyed)
@@ -126,11 +298,176 @@ class Hypergraph {
                             std::stack< Mapping >& searchSpace,        //< The search space of the matching phase for reusage
                             MatchFunc mf                               //< A binary function Hyperedges m(Hypergraph&, Hyperedge&)
                           ) const;
+        template< typename MatchFunc > Hypergraph rewrite(
+                            const Hypergraph& lhs,                     //< The matching graph
+                            const Hypergraph& rhs,                     //< The replacment graph
+                            const Mapping& partialMap,                 //< A partial map from lhs to rhs (N:N)
+                            MatchState& state,                         //< The state of the matching phase for reusage
+                            MatchFunc mf                               //< A binary function Hyperedges m(Hypergraph&, Hyperedge&)
+                          ) const;
+        Hypergraph rewrite(
+                            const Mapping& m,                          //< A match of lhs in this graph (lhs -> this)
+                            const Hypergraph& rhs,                     //< The replacment graph
+                            const Mapping& partialMap                  //< A partial map from lhs to rhs (N:N)
+                          ) const;
+        // In place variants: Instead of building a new graph, only the matched hedges and their wiring to the rest of the graph get changed.
+        // So the costs depend on the size of the match and its neighbourhood instead of the size of the graph.
+        // The result is the same as with rewrite, except that the properties of preserved hedges are kept and the order of from/to sets may differ.
+        // All changes are recorded in the change log (if any). Returns the hedges of the replacement without Zero (empty if there is no match).
+        Hyperedges rewriteInPlace(
+                            const Mapping& m,                          //< A match of lhs in this graph (lhs -> this)
+                            const Hypergraph& rhs,                     //< The replacment graph
+                            const Mapping& partialMap                  //< A partial map from lhs to rhs (N:N)
+                          );
+        template< typename MatchFunc > Hyperedges rewriteInPlace(
+                            const Hypergraph& lhs,                     //< The matching graph
+                            const Hypergraph& rhs,                     //< The replacment graph
+                            const Mapping& partialMap,                 //< A partial map from lhs to rhs (N:N)
+                            MatchFunc mf                               //< A binary function Hyperedges m(Hypergraph&, Hyperedge&)
+                          );
 
     protected:
+        template< typename MatchFunc > void prepareMatch(const Hypergraph& other, MatchState& state, MatchFunc m) const;
+        void prepareMatch(const Hypergraph& other, MatchState& state) const;   // Computes everything the engines need from the candidates
+        template< typename MatchFunc > void prepareMatch(const CompiledPattern& pattern, MatchState& state, MatchFunc m) const;
+        void prepareMatch(const CompiledPattern& pattern, MatchState& state) const;
+        void breakSymmetries(const Hypergraph& other, MatchState& state, const bool expand) const;   // Adds the symmetry breaking constraints (VF2 only)
+        MatchSummary enumerateMatches(const MatchState& state, const std::function< bool (const Mapping&) >& sink, const MatchOptions& options) const;
+        Mapping nextMatch(const Hypergraph& other, MatchState& state) const;
+        Mapping matchUllmann(const Hypergraph& other, MatchState& state) const;
+        Mapping matchVF2(const Hypergraph& other, MatchState& state) const;
+        Mapping matchVF2InPlace(MatchState& state) const;
+
         // Stores all hyperedges belonging to a certain graph instance
         // For fast lookup, we use the UniqueId to retrieve the corresponding hyperedge
         std::unordered_map<UniqueId, Hyperedge> _edges;
+        ChangeLog* _log;
+        unsigned long long _version;
+};
+
+/*
+    A compiled pattern is a query graph together with its match plan (see MatchState):
+    * the order in which the query hedges get mapped
+    * the constraints of each position to the positions mapped before (the query adjacency restricted to the plan)
+    * the number of query neighbours of each position which get mapped later (for the look-ahead)
+
+    The plan does not depend on any data graph, so a pattern can be compiled once and matched against any number of data graphs (see Hypergraph::match).
+    If the statistics of a (typical) data graph are given, the order minimizes the estimated number of partial matches:
+    Every step picks the hedge with the fewest expected extensions (its expected candidates, or the expected fanout from a mapped neighbour
+    reduced by the chance of meeting all other mapped neighbours). So selective hedges come first, even if their degree is low.
+    Only the candidates have to be computed for every data graph.
+    Compiled patterns can be stored and loaded using YAML (see HypergraphYAML).
+*/
+class CompiledPattern
+{
+    friend class Hypergraph;
+
+    public:
+        // A constraint (j, TO) of position i means: m(order[j]) has to be in the TO set of m(order[i]).
+        // (j, IN_TO) means: m(order[i]) has to be in the TO set of m(order[j]). Same for FROM.
+        enum Constraint { TO, FROM, IN_TO, IN_FROM };
+        using Constraints = std::vector< std::pair< unsigned, Constraint > >;
+
+        CompiledPattern() {}
+        explicit CompiledPattern(const Hypergraph& query);                            // Plans the search for query
+        // Plans the search for query using the statistics of a data graph (see below)
+        CompiledPattern(const Hypergraph& query, const GraphStatistics& statistics);
+        CompiledPattern(const Hypergraph& query, const Hyperedges& order);            // Plans the search for query using the given order of its hedges
+        // Restores a stored plan (see valid)
+        CompiledPattern(const Hypergraph& query, const Hyperedges& order, const std::vector< Constraints >& constraints, const std::vector< unsigned >& unmappedNeighbours);
+        bool valid() const;                                                           // false if the order is no permutation of the query hedges or the plan does not fit to the query
+
+        const Hypergraph& query() const { return _query; }
+        const Hyperedges& order() const { return _order; }
+        const std::vector< Constraints >& constraints() const { return _constraints; }
+        const std::vector< unsigned >& unmappedNeighbours() const { return _unmappedNeighbours; }
+
+    protected:
+        bool ordersQuery() const;                                                     // true if the order is a permutation of the query hedges
+        using Neighbours = std::unordered_map< UniqueId, Hyperedges >;
+        static Neighbours neighboursOf(const Hypergraph& query, const Hyperedges& ids);    // The distinct neighbours of each query hedge (without itself)
+        // Orders the query hedges: Most connections to the ones ordered before first, then the one with the lowest cost, then the one with the highest degree
+        static Hyperedges orderOf(const Hyperedges& ids, const Neighbours& neighbours, const std::function< unsigned (const UniqueId&) >& cost);
+        // Computes the constraints and look-ahead counts of an order
+        static void plan(const Hypergraph& query, const Hyperedges& order, const Neighbours& neighbours,
+                         std::vector< Constraints >& constraints, std::vector< unsigned >& unmappedNeighbours);
+
+        Hypergraph _query;
+        Hyperedges _order;
+        std::vector< Constraints > _constraints;
+        std::vector< unsigned > _unmappedNeighbours;
+};
+
+/*
+    The state of a (resumable) search for a query graph in a data graph (see Hypergraph::match)
+
+    It caches everything which only depends on the two graphs: the candidates of each query hedge,
+    the query adjacency, the match order and the constraints of each position (VF2).
+    So enumerating N matches pays for the setup only once.
+
+    The VF2 search itself runs on a snapshot of the data graph (see CompactHypergraph): the state is the handle mapped at each position,
+    a cursor into the candidates of each position and a bitmap of the used data hedges. These get extended and undone in place,
+    so the search needs O(query size) memory besides the snapshot and does not allocate.
+    NOTE: A state belongs to one pair of query & data graph. After changing one of them, call reset().
+*/
+class MatchState
+{
+    friend class Hypergraph;
+
+    public:
+        MatchState(const Hypergraph::MatchEngine engine=Hypergraph::VF2);
+
+        Hypergraph::MatchEngine engine() const { return _engine; }
+        bool prepared() const { return _prepared; }     // true after the first call of match
+        bool exhausted() const { return _exhausted; }   // true if all matches have been found
+        const Hyperedges& order() const { return _order; }  // The order in which the query hedges get mapped (VF2 only)
+        void reset();                                   // Forgets everything, so the next call of match starts a new search
+
+    protected:
+        using Constraint = CompiledPattern::Constraint;
+
+        Hypergraph::MatchEngine _engine;
+        bool _prepared;
+        bool _exhausted;
+        Hyperedges _queryIds;                                                       // sorted
+        std::unordered_map< UniqueId, Hyperedges > _candidateIds;
+        std::unordered_map< UniqueId, std::unordered_set< UniqueId > > _isCandidate;
+        std::unordered_map< UniqueId, Hyperedges > _queryNeighbours;               // without the hedge itself
+        UniqueId _startId;                                                          // ULLMANN only
+        Hyperedges _order;
+        std::vector< CompiledPattern::Constraints > _constraints;                 // to the positions mapped before (or itself)
+        std::vector< unsigned > _unmappedNeighbours;                                // number of query neighbours mapped later
+        std::stack< Mapping > _searchSpace;
+        bool _fromSearchSpace;                                                      // VF2 uses the copying _searchSpace instead of the in place search
+
+        /*In place search (VF2)*/
+        // The state of one depth first search. Parallel searches use one per thread and share the rest of the MatchState.
+        struct Search
+        {
+            std::vector< unsigned > mapped;                                         // handle mapped at each position
+            std::vector< const unsigned* > cursor;                                  // next candidate to try at each position
+            std::vector< const unsigned* > end;
+            std::vector< bool > local;                                              // candidates come from the neighbourhood of a mapped hedge
+            std::vector< bool > used;                                               // bitmap over the data handles
+            unsigned depth = 0;                                                     // number of mapped positions
+        };
+        void start(Search& search) const;                                           // Starts a search over all candidates of the first position
+        bool start(Search& search, const unsigned root) const;                      // Starts a search below root mapped at the first position (false if infeasible)
+        void open(Search& search, const unsigned position) const;                   // Selects the candidates of a position
+        bool feasible(const Search& search, const unsigned position, const unsigned candidate) const;
+        // Continues the search until the next match (true) or until the positions below fixed are exhausted (false). Stops early (false) if cancelled becomes true.
+        bool next(Search& search, const unsigned fixed, const std::atomic< bool >* cancelled=nullptr) const;
+        Mapping mapping(const Search& search, const unsigned automorphism=0) const; // The current (complete) mapping (composed with one of the automorphisms)
+        void bind(const Hypergraph& data);                                          // Takes the snapshot of the data graph and the candidate handles
+
+        std::shared_ptr< CompactHypergraph > _data;                                 // snapshot of the data graph
+        std::vector< std::vector< unsigned > > _candidates;                         // sorted candidate handles of each position
+        /*Symmetry breaking*/
+        // The image of a position has to be greater than the images of the (earlier) positions listed here.
+        // This leaves one match per orbit of the automorphism group of the query (see Hypergraph::breakSymmetries)
+        std::vector< std::vector< unsigned > > _symmetries;
+        std::vector< std::vector< unsigned > > _automorphisms;                      // if expanded: all automorphisms as permutations of the positions
+        Search _search;
 };
 
 // Include template member functions
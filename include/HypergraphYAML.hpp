@@ -21,6 +21,7 @@ namespace YAML {
 
     // Easy to use function to create a order preserving serialization of a Hypergraph
     std::string StringFrom(const Hypergraph& g);
+    std::string StringFrom(const CompiledPattern& p);
 
     template<>
         struct convert<Hyperedge> {
@@ -140,6 +141,75 @@ namespace YAML {
                 return true;
             }
         };
+
+    template<>
+        struct convert<CompiledPattern> {
+
+            static const char* constraintName(const CompiledPattern::Constraint c) {
+                static const char* names[] = {"TO", "FROM", "IN_TO", "IN_FROM"};
+                return names[c];
+            }
+
+            static Node encode(const CompiledPattern& rhs) {
+                Node node;
+                node["query"] = rhs.query();
+                for (unsigned i = 0; i < rhs.order().size(); i++)
+                {
+                    Node position;
+                    position["id"] = rhs.order()[i];
+                    position["unmappedNeighbours"] = rhs.unmappedNeighbours()[i];
+                    for (const auto& constraint : rhs.constraints()[i])
+                    {
+                        Node entry;
+                        entry.push_back(constraint.first);
+                        entry.push_back(constraintName(constraint.second));
+                        position["constraints"].push_back(entry);
+                    }
+                    node["plan"].push_back(position);
+                }
+                return node;
+            }
+
+            static bool decode(const Node& node, CompiledPattern& rhs) {
+                if (!node["query"] || !node["plan"])
+                    return false;
+                Hypergraph query;
+                if (!convert<Hypergraph>::decode(node["query"], query))
+                    return false;
+                Hyperedges order;
+                std::vector< CompiledPattern::Constraints > constraints;
+                std::vector< unsigned > unmappedNeighbours;
+                for (auto it = node["plan"].begin(); it != node["plan"].end(); it++)
+                {
+                    const Node& current(*it);
+                    order.push_back(current["id"].as<UniqueId>());
+                    unmappedNeighbours.push_back(current["unmappedNeighbours"].as<unsigned>());
+                    constraints.push_back(CompiledPattern::Constraints());
+                    if (!current["constraints"])
+                        continue;
+                    for (auto cit = current["constraints"].begin(); cit != current["constraints"].end(); cit++)
+                    {
+                        const std::string& name((*cit)[1].as<std::string>());
+                        unsigned c = 0;
+                        while ((c <= CompiledPattern::IN_FROM) && (name != constraintName(CompiledPattern::Constraint(c))))
+                            c++;
+                        if (c > CompiledPattern::IN_FROM)
+                        {
+                            std::cout << "YAML::decode(CompiledPattern): unknown constraint " << name << "\n";
+                            return false;
+                        }
+                        constraints.back().push_back({(*cit)[0].as<unsigned>(), CompiledPattern::Constraint(c)});
+                    }
+                }
+                rhs = CompiledPattern(query, order, constraints, unmappedNeighbours);
+                if (!rhs.valid())
+                {
+                    std::cout << "YAML::decode(CompiledPattern): plan does not fit to the query\n";
+                    return false;
+                }
+                return true;
+            }
+        };
 }
 
 #endif
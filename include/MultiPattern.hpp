@@ -0,0 +1,84 @@
+#ifndef _MULTI_PATTERN_HPP
+#define _MULTI_PATTERN_HPP
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include "Hypergraph.hpp"
+
+/*
+    A multi pattern is a set of query graphs compiled into one shared plan, so they can be matched against a data graph in a single search.
+
+    The plan is a trie of match orders: Every node maps one query hedge of each query passing through it.
+    Query hedges share a node, if they have the same label and the same constraints to the positions mapped before (see CompiledPattern).
+    While planning a query, it follows the existing nodes as long as one of its hedges fits (and keeps the search connected).
+    So queries with a common core (e.g. "instance of X has part Y") find the partial matches of that core only once and extend them per query.
+
+    Since the query hedges of a node can have different candidates, every partial match carries the set of queries it is still valid for.
+    A partial match is only extended as long as this set is not empty.
+
+    Like CompiledPattern, the plan does not depend on any data graph. Only the candidates have to be computed for every data graph.
+*/
+
+// Result of MultiPattern::matchAll
+struct MultiMatchSummary
+{
+    std::vector< unsigned long long > matches;      //< Number of matches of each query (passed to the sink or counted)
+    bool complete;                                  //< false if the search has been stopped early (by the sink, maxResults or timeBudget)
+    unsigned long long extensions;                  //< Partial matches built by the shared search
+    unsigned long long separateExtensions;          //< Partial matches the queries would have built one by one (using the same match orders and their own look-ahead)
+};
+
+class MultiPattern
+{
+    public:
+        MultiPattern(const std::vector< Hypergraph >& queries);
+
+        unsigned size() const { return _queries.size(); }                          // Number of queries
+        const Hypergraph& query(const unsigned q) const { return _queries[q]; }
+        const Hyperedges& order(const unsigned q) const { return _orders[q]; }      // The match order of a query
+        unsigned positions() const { return _nodes.size() - 1; }                    // Number of positions of the shared plan
+        unsigned separatePositions() const;                                         // Number of positions of all queries
+
+        // Streams the matches of all queries to the sink bool sink(const unsigned query, const Mapping&). If the sink returns false, the search stops.
+        // Options: maxResults (over all queries), timeBudget and countOnly. The search is sequential and does not break symmetries.
+        template< typename Sink, typename MatchFunc > MultiMatchSummary matchAll(const Hypergraph& data, Sink sink, const MatchOptions& options, MatchFunc m) const
+        {
+            std::vector< std::unordered_map< UniqueId, Hyperedges > > candidates(_queries.size());
+            for (unsigned q = 0; q < _queries.size(); q++)
+            {
+                for (const UniqueId& id : _orders[q])
+                    candidates[q][id] = m(data, _queries[q].access(id));
+            }
+            return enumerate(data, candidates, sink, options);
+        }
+        template< typename Sink > MultiMatchSummary matchAll(const Hypergraph& data, Sink sink, const MatchOptions& options=MatchOptions()) const
+        {
+            return matchAll(data, sink, options, Hypergraph::defaultMatchFunc);
+        }
+
+    protected:
+        // A position of the shared plan
+        struct Node
+        {
+            std::string label;
+            CompiledPattern::Constraints constraints;                               // to the positions mapped before (or itself), sorted
+            unsigned depth;                                                         // the position
+            unsigned lookAhead;                                                     // smallest number of query neighbours mapped later
+            std::vector< std::pair< unsigned, UniqueId > > members;                // (query, query hedge) mapped at this node
+            std::vector< unsigned > lookAheads;                                     // number of query neighbours mapped later of each member
+            std::vector< unsigned > complete;                                       // queries fully mapped at this node
+            std::vector< unsigned > children;
+        };
+
+        MultiMatchSummary enumerate(const Hypergraph& data, const std::vector< std::unordered_map< UniqueId, Hyperedges > >& candidates,
+                                    const std::function< bool (const unsigned, const Mapping&) >& sink, const MatchOptions& options) const;
+
+        std::vector< Hypergraph > _queries;
+        std::vector< Hyperedges > _orders;
+        std::vector< std::vector< unsigned > > _paths;                              // the nodes of each query (one per position)
+        std::vector< Node > _nodes;                                                 // the first node is the root (without a position)
+};
+
+#endif
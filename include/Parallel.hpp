@@ -0,0 +1,142 @@
+#ifndef _PARALLEL_HPP
+#define _PARALLEL_HPP
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+
+/*
+    Minimal helpers to run data parallel loops on plain std::threads.
+    A thread count of 0 means: use all available hardware threads.
+*/
+
+inline unsigned threadCount(const unsigned requested=0)
+{
+    if (requested)
+        return requested;
+    const unsigned available(std::thread::hardware_concurrency());
+    return available ? available : 1;
+}
+
+// Splits [first, last) into (at most) threads contiguous chunks and calls f(chunkFirst, chunkLast, threadIndex) for each of them concurrently
+template< typename Func > void parallelFor(const unsigned first, const unsigned last, const unsigned threads, Func f)
+{
+    if (last <= first)
+        return;
+    const unsigned n(std::min(threadCount(threads), last - first));
+    if (n < 2)
+    {
+        // No need to spawn any threads
+        f(first, last, 0u);
+        return;
+    }
+    const unsigned chunk((last - first + n - 1) / n);
+    std::vector< std::thread > workers;
+    for (unsigned t = 0; t < n; t++)
+    {
+        const unsigned chunkFirst(first + t * chunk);
+        const unsigned chunkLast(std::min(last, chunkFirst + chunk));
+        if (chunkFirst >= chunkLast)
+            break;
+        workers.push_back(std::thread(f, chunkFirst, chunkLast, t));
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+// Calls f(task, threadIndex) for every task in [first, last) on (at most) threads threads using work stealing:
+// Every thread owns a contiguous range of tasks and processes it front to back.
+// A thread running out of tasks steals the back half of the largest remaining range of another thread.
+// If f returns false, all remaining tasks are cancelled (running ones finish).
+template< typename Func > void parallelForEachTask(const unsigned first, const unsigned last, const unsigned threads, Func f)
+{
+    if (last <= first)
+        return;
+    const unsigned n(std::min(threadCount(threads), last - first));
+    if (n < 2)
+    {
+        // No need to spawn any threads
+        for (unsigned task = first; task < last; task++)
+        {
+            if (!f(task, 0u))
+                break;
+        }
+        return;
+    }
+
+    struct Range
+    {
+        std::mutex mutex;
+        unsigned next;
+        unsigned last;
+    };
+    std::vector< Range > ranges(n);
+    const unsigned chunk((last - first + n - 1) / n);
+    for (unsigned t = 0; t < n; t++)
+    {
+        ranges[t].next = std::min(last, first + t * chunk);
+        ranges[t].last = std::min(last, ranges[t].next + chunk);
+    }
+    std::atomic< bool > cancelled(false);
+
+    auto work = [&](const unsigned t) {
+        Range& own(ranges[t]);
+        while (!cancelled)
+        {
+            unsigned task = last;
+            {
+                std::lock_guard< std::mutex > lock(own.mutex);
+                if (own.next < own.last)
+                    task = own.next++;
+            }
+            if (task < last)
+            {
+                if (!f(task, t))
+                    cancelled = true;
+                continue;
+            }
+
+            // Steal from the thread with the most remaining tasks
+            unsigned victim = n;
+            unsigned most = 0;
+            for (unsigned v = 0; v < n; v++)
+            {
+                if (v == t)
+                    continue;
+                std::lock_guard< std::mutex > lock(ranges[v].mutex);
+                const unsigned remaining(ranges[v].last - ranges[v].next);
+                if (remaining > most)
+                {
+                    most = remaining;
+                    victim = v;
+                }
+            }
+            if (victim == n)
+                break;
+            unsigned stolenFirst;
+            unsigned stolenLast;
+            {
+                std::lock_guard< std::mutex > lock(ranges[victim].mutex);
+                Range& other(ranges[victim]);
+                if (other.next >= other.last)
+                    continue;
+                stolenFirst = other.next + (other.last - other.next) / 2;
+                stolenLast = other.last;
+                other.last = stolenFirst;
+            }
+            std::lock_guard< std::mutex > lock(own.mutex);
+            own.next = stolenFirst;
+            own.last = stolenLast;
+        }
+    };
+
+    std::vector< std::thread > workers;
+    for (unsigned t = 0; t < n; t++)
+        workers.push_back(std::thread(work, t));
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+#endif
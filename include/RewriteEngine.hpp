@@ -0,0 +1,88 @@
+#ifndef _REWRITE_ENGINE_HPP
+#define _REWRITE_ENGINE_HPP
+
+#include <vector>
+#include <set>
+#include <string>
+#include "Hypergraph.hpp"
+
+/*
+    The rewrite engine applies a set of rules to a data graph until no rule matches anymore (fixpoint), e.g. to normalize an ontology.
+
+    A rule is a single pushout (see Hypergraph::rewrite) given by lhs, rhs and a partial map from lhs to rhs.
+    The engine works in rounds:
+    * All rules get matched within the region affected by the previous round (the whole data graph in the first round).
+      The region consists of all hedges within k hops of a changed hedge, where k is the largest radius of the rules (see StandingQueries).
+      Rules with a disconnected lhs are always matched against the whole data graph.
+      Rules are matched concurrently (the data graph is not changed while matching).
+    * Matches which do not share a hedge with a match selected before get applied in place (see Hypergraph::rewriteInPlace).
+      Rules listed first take precedence. All other matches overlap an applied one, so they lie in the next region and get matched again.
+      Every selected match gets checked again right before it is applied, since applying another one may have changed its hedges or wires.
+    * The changes are recorded in a change log, which gives the region of the next round.
+
+    Every embedding of a rule fires at most once. Otherwise rules which preserve their lhs (e.g. adding a transitive relation) would never stop.
+    Hedges of rhs which are not in the image of the partial map get a fresh id on every firing (derived from the id and the matched hedges),
+    unless a hedge with the same id exists in the data graph. Then (like rewrite) it refers to that hedge.
+    NOTE: Rule sets creating new embeddings on every firing do not reach a fixpoint. Use the limits of RewriteOptions then.
+*/
+
+struct RewriteRule
+{
+    std::string name;
+    Hypergraph lhs;                     //< The matching graph
+    Hypergraph rhs;                     //< The replacement graph
+    Mapping partialMap;                 //< A partial map from lhs to rhs (unmapped lhs hedges get destroyed)
+};
+
+// Options of RewriteEngine::run
+struct RewriteOptions
+{
+    unsigned long long maxFirings = 0;  //< Stop after this many rule firings (0: no limit)
+    unsigned timeBudget = 0;            //< Stop after this many milliseconds (0: no limit, checked after every round)
+    unsigned threads = 1;               //< Number of threads used for matching the rules (0: all cores)
+};
+
+// Result of RewriteEngine::run
+struct RewriteSummary
+{
+    std::vector< unsigned long long > firings;  //< Number of firings of each rule
+    unsigned long long total;                   //< Number of firings of all rules
+    unsigned long long rounds;                  //< Number of rounds (including the last one without firings)
+    unsigned long long conflicts;               //< Matches postponed to the next round because they overlap or got invalidated by an applied match
+    bool fixpoint;                              //< false if the run has been stopped early (by maxFirings or timeBudget)
+    double seconds;                             //< Duration of the run
+
+    double firingsPerSecond() const { return (seconds > 0.0) ? (total / seconds) : 0.0; }
+};
+
+class RewriteEngine
+{
+    public:
+        RewriteEngine(const std::vector< RewriteRule >& rules);
+
+        unsigned size() const { return _rules.size(); }                                // Number of rules
+        const RewriteRule& rule(const unsigned r) const { return _rules[r]; }
+        unsigned radius(const unsigned r) const { return _radii[r]; }                 // see StandingQueries::radiusOf
+
+        // Applies the rules to data until fixpoint (or until a limit is reached). All changes are also recorded into the change log of data (if any).
+        RewriteSummary run(Hypergraph& data, const RewriteOptions& options=RewriteOptions()) const;
+
+    protected:
+        // A match of a rule found in a round
+        struct Firing
+        {
+            unsigned rule;
+            Mapping embedding;
+        };
+
+        // Finds all matches of every rule within region (the whole data graph if nullptr)
+        std::vector< std::vector< Mapping > > matchRules(const Hypergraph& data, const Hyperedges* region, const unsigned threads) const;
+        // The rhs of a rule with fresh ids for the hedges to be created
+        Hypergraph instantiate(const unsigned r, const Mapping& embedding, const Hypergraph& data) const;
+
+        std::vector< RewriteRule > _rules;
+        std::vector< unsigned > _radii;
+        std::vector< Hyperedges > _created;                                             // the rhs hedges not in the image of the partial map
+};
+
+#endif
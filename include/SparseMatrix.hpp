@@ -0,0 +1,60 @@
+#ifndef _SPARSE_MATRIX_HPP
+#define _SPARSE_MATRIX_HPP
+
+#include <vector>
+#include <climits>
+
+/*
+    Sparse matrices & vectors over dense handles (see CompactHypergraph).
+
+    This turns the incidence matrix view of a hypergraph (see Hyperedge) into real matrices,
+    such that traversals can be expressed as (masked) sparse matrix times sparse vector products (GraphBLAS style).
+    The products use the boolean (OR, AND) semiring, so only the sparsity pattern matters for them.
+*/
+
+using Handle = unsigned;
+
+// A sparse vector of dimension size storing the sorted indices of its non-zero entries
+struct SparseVector
+{
+    unsigned size;
+    std::vector< Handle > indices;
+
+    SparseVector(const unsigned n=0, const std::vector< Handle >& nonZeros=std::vector< Handle >());
+};
+
+// A compressed sparse row matrix. The column indices of row r are indices[offsets[r]] ... indices[offsets[r+1]-1] (sorted)
+// NOTE: A CSC matrix is represented as the CSR matrix of its transpose
+struct SparseMatrix
+{
+    unsigned rows;
+    unsigned cols;
+    std::vector< unsigned > offsets;
+    std::vector< Handle > indices;
+    std::vector< unsigned > values;     // The values of the non-zero entries (e.g. how often a hedge points to another one)
+
+    SparseMatrix(const unsigned r=0, const unsigned c=0);
+    unsigned nonZeros() const { return indices.size(); }
+    SparseMatrix transposed() const;
+};
+
+// A matrix in coordinate (COO) format, ordered by row and column
+struct CoordinateMatrix
+{
+    unsigned rows;
+    unsigned cols;
+    std::vector< Handle > rowIndices;
+    std::vector< Handle > colIndices;
+    std::vector< unsigned > values;
+};
+
+CoordinateMatrix toCoordinates(const SparseMatrix& m);                  //< Converts CSR to COO
+
+// Computes y<mask> = x * A over the boolean semiring: y contains all columns reachable from any row in x.
+// If mask is not empty, only columns c with mask[c] == true are kept (or with mask[c] == false if complementMask is set)
+SparseVector multiply(const SparseVector& x, const SparseMatrix& A, const std::vector< bool >& mask=std::vector< bool >(), const bool complementMask=false);
+
+// Breadth first search as repeated masked products: Returns the level (distance) of each index from the sources (UINT_MAX if unreachable)
+std::vector< unsigned > breadthFirstLevels(const SparseMatrix& A, const std::vector< Handle >& sources, const unsigned maxLevel=UINT_MAX);
+
+#endif
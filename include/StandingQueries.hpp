@@ -0,0 +1,69 @@
+#ifndef _STANDING_QUERIES_HPP
+#define _STANDING_QUERIES_HPP
+
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <functional>
+#include <climits>
+#include "Hypergraph.hpp"
+
+/*
+    Standing queries are query graphs registered once and matched continuously while the data graph changes (e.g. for alerting).
+
+    The data graph records its changes into a change log (see Hypergraph::record). Every call of update() consumes the log:
+    * The known embeddings which use a changed hedge get checked again. The ones which do not hold anymore are passed to the sink as invalidated.
+    * New embeddings have to use a changed hedge. So a connected query is only matched within k hops of the changed hedges,
+      where k is the largest distance of two query hedges. Disconnected queries are matched against the whole data graph.
+      So are queries with a hedge whose id got created or destroyed in the data graph (it switches between matching by id and by label).
+    So the cost of an update is proportional to the neighbourhood of the changes instead of the size of the data graph.
+
+    Embeddings are mappings from the query to the data graph as found by Hypergraph::match (using defaultMatchFunc).
+    NOTE: The data graph has to outlive the standing queries. Changes made through Hypergraph::access() are not recorded, so they are not noticed.
+*/
+
+class StandingQueries
+{
+    public:
+        // Receives every embedding which appears (added) or disappears (!added)
+        using Sink = std::function< void (const Mapping& embedding, const bool added) >;
+
+        StandingQueries(Hypergraph& data);                         // Starts recording the changes of data
+        StandingQueries(const StandingQueries& other) = delete;
+        StandingQueries& operator= (const StandingQueries& other) = delete;
+        ~StandingQueries();                                         // Stops recording
+
+        // Registers a query and returns its number. All its current embeddings are passed to the sink.
+        unsigned add(const Hypergraph& query, Sink sink);
+        void remove(const unsigned query);                          // Unregisters a query (without calling its sink)
+        // Processes all changes since the last update and returns the number of embeddings passed to the sinks
+        unsigned long long update();
+
+        const std::set< Mapping >& embeddings(const unsigned query) const { return _queries.at(query).embeddings; }
+        const ChangeLog& pending() const { return _log; }          // The changes not processed yet
+        // Largest distance of two hedges of the query (without Zero) or UINT_MAX if the query is disconnected
+        static unsigned radiusOf(const Hypergraph& query);
+        // Checks if an embedding of query (as found by Hypergraph::match) is still valid in data
+        static bool holds(const Hypergraph& data, const Hypergraph& query, const Mapping& embedding);
+
+    protected:
+        struct Query
+        {
+            Hypergraph graph;
+            Sink sink;
+            unsigned radius;                                        // largest distance of two query hedges (UINT_MAX: disconnected)
+            std::set< Mapping > embeddings;
+            std::unordered_map< UniqueId, std::set< const Mapping* > > byHedge;    // the embeddings using a data hedge (without Zero)
+        };
+
+        // Finds all embeddings within the given hedges (the whole data graph if nullptr) and passes the unknown ones to the sink
+        unsigned long long discover(Query& query, const Hyperedges* region);
+        void forget(Query& query, const Mapping& embedding);
+
+        Hypergraph& _data;
+        ChangeLog _log;
+        unsigned _next;
+        std::unordered_map< unsigned, Query > _queries;
+};
+
+#endif
@@ -0,0 +1,402 @@
+#include "CandidateIndex.hpp"
+
+#include <algorithm>
+#include <map>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <iostream>
+
+// Removes leading and trailing whitespace
+static std::string trim(const std::string& text)
+{
+    const std::size_t first(text.find_first_not_of(" \t\r\n"));
+    if (first == std::string::npos)
+        return "";
+    const std::size_t last(text.find_last_not_of(" \t\r\n"));
+    return text.substr(first, last - first + 1);
+}
+
+bool PropertyConstraint::matches(const Hyperedge& hedge) const
+{
+    if (!hedge.hasProperty(key))
+        return false;
+    if (op == EXISTS)
+        return true;
+    const std::string& actual(hedge.property(key));
+    char* end;
+    const double a(std::strtod(actual.c_str(), &end));
+    const bool aNumber(!actual.empty() && !*end && !std::isnan(a));
+    const double b(std::strtod(value.c_str(), &end));
+    const bool bNumber(!value.empty() && !*end && !std::isnan(b));
+    if (op == EQUAL)
+        return (aNumber == bNumber) && (aNumber ? (a == b) : (actual == value));
+    if (op == NOT_EQUAL)
+        return (aNumber != bNumber) || (aNumber ? (a != b) : (actual != value));
+    // Ordering is only defined between values of the same kind
+    if (aNumber != bNumber)
+        return false;
+    const int cmp(aNumber ? ((a < b) ? -1 : ((b < a) ? 1 : 0)) : actual.compare(value));
+    switch (op)
+    {
+        case LESS:
+            return cmp < 0;
+        case LESS_EQUAL:
+            return cmp <= 0;
+        case GREATER:
+            return cmp > 0;
+        case GREATER_EQUAL:
+            return cmp >= 0;
+        default:
+            return false;
+    }
+}
+
+bool PropertyConstraint::parse(const std::string& expression, PropertyConstraint& result)
+{
+    const std::size_t first(expression.find_first_of("=!<>"));
+    result.key = trim(expression.substr(0, first));
+    if (result.key.empty())
+        return false;
+    if (first == std::string::npos)
+    {
+        result.op = EXISTS;
+        result.value.clear();
+        return true;
+    }
+    const std::size_t last(expression.find_first_not_of("=!<>", first));
+    const std::string op(expression.substr(first, (last == std::string::npos) ? std::string::npos : last - first));
+    if ((op == "==") || (op == "="))
+        result.op = EQUAL;
+    else if (op == "!=")
+        result.op = NOT_EQUAL;
+    else if (op == "<")
+        result.op = LESS;
+    else if (op == "<=")
+        result.op = LESS_EQUAL;
+    else if (op == ">")
+        result.op = GREATER;
+    else if (op == ">=")
+        result.op = GREATER_EQUAL;
+    else
+        return false;
+    result.value = (last == std::string::npos) ? "" : trim(expression.substr(last));
+    return !result.value.empty();
+}
+
+PropertyConstraints propertyConstraintsOf(const Hypergraph& query, const std::string& key)
+{
+    PropertyConstraints result;
+    for (const UniqueId& id : query.findByLabel())
+    {
+        const Hyperedge& hedge(query.access(id));
+        if (!hedge.hasProperty(key))
+            continue;
+        std::stringstream expressions(hedge.property(key));
+        std::string expression;
+        while (std::getline(expressions, expression, ';'))
+        {
+            PropertyConstraint constraint;
+            if (trim(expression).empty())
+                continue;
+            if (!PropertyConstraint::parse(expression, constraint))
+            {
+                std::cout << "propertyConstraintsOf(): Invalid property constraint '" << expression << "' of " << id << "\n";
+                continue;
+            }
+            result[id].push_back(constraint);
+        }
+    }
+    return result;
+}
+
+CandidateIndex::Value::Value(const std::string& value)
+: string(value)
+{
+    char* end;
+    number = std::strtod(value.c_str(), &end);
+    text = value.empty() || *end || std::isnan(number);
+}
+
+bool CandidateIndex::Value::operator< (const Value& other) const
+{
+    if (text != other.text)
+        return other.text;
+    return text ? (string < other.string) : (number < other.number);
+}
+
+// Computes the label frequencies of the next (forward) or previous neighbours of every hedge
+static void buildSignatures(const CompactHypergraph& data, const bool forward,
+                            std::vector< unsigned >& offsets, std::vector< std::pair< unsigned, unsigned > >& signatures)
+{
+    const unsigned n(data.size());
+    offsets.assign(n + 1, 0);
+    std::vector< unsigned > labels;
+    for (Handle h = 0; h < n; h++)
+    {
+        labels.clear();
+        for (const Handle other : (forward ? data.next(h) : data.previous(h)))
+            labels.push_back(data.label(other));
+        std::sort(labels.begin(), labels.end());
+        for (unsigned i = 0; i < labels.size(); i++)
+        {
+            if (i && (labels[i - 1] == labels[i]))
+                signatures.back().second++;
+            else
+                signatures.push_back({labels[i], 1});
+        }
+        offsets[h + 1] = signatures.size();
+    }
+}
+
+// Checks if the signature [first, last) has at least the counts of all labels in required (both ordered by label)
+static bool includes(const std::pair< unsigned, unsigned >* first, const std::pair< unsigned, unsigned >* last,
+                     const std::vector< std::pair< unsigned, unsigned > >& required)
+{
+    for (const auto& entry : required)
+    {
+        while ((first != last) && (first->first < entry.first))
+            first++;
+        if ((first == last) || (first->first != entry.first) || (first->second < entry.second))
+            return false;
+    }
+    return true;
+}
+
+CandidateIndex::CandidateIndex(const Hypergraph& data, const std::vector< std::string >& indexedKeys)
+: _data(data)
+{
+    const unsigned n(_data.size());
+    _indegrees.resize(n);
+    _outdegrees.resize(n);
+    std::vector< std::map< std::pair< unsigned, unsigned >, std::vector< Handle > > > buckets(_data.labelCount());
+    for (Handle h = 0; h < n; h++)
+    {
+        const Hyperedge& hedge(data.access(_data.id(h)));
+        _indegrees[h] = hedge.indegree();
+        _outdegrees[h] = hedge.outdegree();
+        // NOTE: Since we visit the handles in order, every bucket stays sorted
+        buckets[_data.label(h)][{bucket(_indegrees[h]), bucket(_outdegrees[h])}].push_back(h);
+    }
+    _buckets.resize(_data.labelCount());
+    for (unsigned l = 0; l < _data.labelCount(); l++)
+    {
+        for (auto& pair : buckets[l])
+        {
+            _buckets[l].push_back(Bucket{pair.first.first, pair.first.second, std::vector< Handle >()});
+            _buckets[l].back().hedges.swap(pair.second);
+        }
+    }
+    buildSignatures(_data, true, _nextOffsets, _nextSignatures);
+    buildSignatures(_data, false, _prevOffsets, _prevSignatures);
+
+    for (const std::string& key : indexedKeys)
+    {
+        PropertyIndex& index(_properties[key]);
+        index.clear();
+        for (Handle h = 0; h < n; h++)
+        {
+            const Hyperedge& hedge(data.access(_data.id(h)));
+            if (hedge.hasProperty(key))
+                index.push_back({Value(hedge.property(key)), h});
+        }
+        std::stable_sort(index.begin(), index.end(), [](const std::pair< Value, Handle >& a, const std::pair< Value, Handle >& b) -> bool { return a.first < b.first; });
+    }
+}
+
+unsigned CandidateIndex::bucket(const unsigned degree)
+{
+    unsigned b = 0;
+    for (unsigned d = degree; d; d >>= 1)
+        b++;
+    return b;
+}
+
+bool CandidateIndex::covers(const Handle h, const Signature& next, const Signature& previous) const
+{
+    return includes(_nextSignatures.data() + _nextOffsets[h], _nextSignatures.data() + _nextOffsets[h + 1], next) &&
+           includes(_prevSignatures.data() + _prevOffsets[h], _prevSignatures.data() + _prevOffsets[h + 1], previous);
+}
+
+CandidateIndex::Signature CandidateIndex::signatureOf(const Hypergraph& query, const Hyperedges& neighbours) const
+{
+    Hyperedges ids(neighbours);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    std::map< unsigned, unsigned > counts;
+    for (const UniqueId& id : ids)
+    {
+        // Skip all neighbours which do not have to match by label
+        if (!query.exists(id) || (_data.handle(id) != CompactHypergraph::Invalid))
+            continue;
+        const std::string& label(query.access(id).label());
+        if (label.empty())
+            continue;
+        // NOTE: A label unknown to the data graph maps to Invalid which no hedge can cover
+        counts[_data.labelOf(label)]++;
+    }
+    return Signature(counts.begin(), counts.end());
+}
+
+Hyperedges CandidateIndex::candidates(const Hypergraph& query, const UniqueId& queryId) const
+{
+    return collect(query, queryId, nullptr, nullptr);
+}
+
+Hyperedges CandidateIndex::candidates(const Hypergraph& data, const Hypergraph& query, const UniqueId& queryId, const std::vector< PropertyConstraint >& constraints) const
+{
+    if (constraints.empty())
+        return collect(query, queryId, nullptr, nullptr);
+
+    // Find the indexed constraint with the smallest range of hedges
+    using Entry = std::pair< Value, Handle >;
+    auto less = [](const Entry& a, const Entry& b) -> bool { return a.first < b.first; };
+    const PropertyConstraint* driving(nullptr);
+    PropertyIndex::const_iterator from, to;
+    for (const PropertyConstraint& constraint : constraints)
+    {
+        auto it(_properties.find(constraint.key));
+        if ((it == _properties.end()) || (constraint.op == PropertyConstraint::NOT_EQUAL))
+            continue;
+        const PropertyIndex& index(it->second);
+        const Entry value(Value(constraint.value), 0);
+        // All numbers are ordered before all strings
+        const Entry firstText(Value(""), 0);
+        auto begin(value.first.text ? std::lower_bound(index.begin(), index.end(), firstText, less) : index.begin());
+        auto end(value.first.text ? index.end() : std::lower_bound(index.begin(), index.end(), firstText, less));
+        switch (constraint.op)
+        {
+            case PropertyConstraint::EXISTS:
+                begin = index.begin();
+                end = index.end();
+                break;
+            case PropertyConstraint::EQUAL:
+                begin = std::lower_bound(begin, end, value, less);
+                end = std::upper_bound(begin, end, value, less);
+                break;
+            case PropertyConstraint::LESS:
+                end = std::lower_bound(begin, end, value, less);
+                break;
+            case PropertyConstraint::LESS_EQUAL:
+                end = std::upper_bound(begin, end, value, less);
+                break;
+            case PropertyConstraint::GREATER:
+                begin = std::upper_bound(begin, end, value, less);
+                break;
+            case PropertyConstraint::GREATER_EQUAL:
+                begin = std::lower_bound(begin, end, value, less);
+                break;
+            default:
+                break;
+        }
+        if (!driving || ((end - begin) < (to - from)))
+        {
+            driving = &constraint;
+            from = begin;
+            to = end;
+        }
+    }
+
+    auto filter = [&](const Handle h) -> bool {
+        const Hyperedge& hedge(data.access(_data.id(h)));
+        for (const PropertyConstraint& constraint : constraints)
+        {
+            if ((&constraint != driving) && !constraint.matches(hedge))
+                return false;
+        }
+        return true;
+    };
+    if (!driving)
+        return collect(query, queryId, nullptr, filter);
+
+    std::vector< Handle > driver;
+    driver.reserve(to - from);
+    for (auto it = from; it != to; it++)
+        driver.push_back(it->second);
+    std::sort(driver.begin(), driver.end());
+    return collect(query, queryId, &driver, filter);
+}
+
+Hyperedges CandidateIndex::MatchFunc::operator()(const Hypergraph& data, const Hyperedge& queryHedge) const
+{
+    if (constraints)
+    {
+        auto it(constraints->find(queryHedge.id()));
+        if (it != constraints->end())
+            return index.candidates(data, query, queryHedge.id(), it->second);
+    }
+    return index.candidates(query, queryHedge.id());
+}
+
+Hyperedges CandidateIndex::collect(const Hypergraph& query, const UniqueId& queryId, const std::vector< Handle >* driver, const std::function< bool (const Handle) >& filter) const
+{
+    const Hyperedge& queryHedge(query.access(queryId));
+    const unsigned in(queryHedge.indegree());
+    const unsigned out(queryHedge.outdegree());
+    const Signature& next(signatureOf(query, query.nextNeighboursOf(Hyperedges{queryId})));
+    const Signature& previous(signatureOf(query, query.previousNeighboursOf(Hyperedges{queryId})));
+    auto accept = [&](const Handle h) -> bool {
+        return (_indegrees[h] >= in) && (_outdegrees[h] >= out) && covers(h, next, previous);
+    };
+
+    std::vector< Handle > result;
+    const Handle self(_data.handle(queryId));
+    if (self != CompactHypergraph::Invalid)
+    {
+        if (accept(self) && (!filter || filter(self)) && (!driver || std::binary_search(driver->begin(), driver->end(), self)))
+            result.push_back(self);
+        return _data.ids(result);
+    }
+
+    // A driver already is a small set of hedges, so we only check each of them
+    if (driver)
+    {
+        const unsigned l(queryHedge.label().empty() ? CompactHypergraph::Invalid : _data.labelOf(queryHedge.label()));
+        if (!queryHedge.label().empty() && (l == CompactHypergraph::Invalid))
+            return Hyperedges();
+        for (const Handle h : *driver)
+        {
+            if ((queryHedge.label().empty() || (_data.label(h) == l)) && accept(h) && (!filter || filter(h)))
+                result.push_back(h);
+        }
+        return _data.ids(result);
+    }
+
+    // Collect the labels to visit (an empty label matches all of them)
+    std::vector< unsigned > labels;
+    if (queryHedge.label().empty())
+    {
+        for (unsigned l = 0; l < _data.labelCount(); l++)
+            labels.push_back(l);
+    } else {
+        const unsigned l(_data.labelOf(queryHedge.label()));
+        if (l != CompactHypergraph::Invalid)
+            labels.push_back(l);
+    }
+
+    const unsigned inBucket(bucket(in));
+    const unsigned outBucket(bucket(out));
+    for (const unsigned l : labels)
+    {
+        const std::vector< Bucket >& buckets(_buckets[l]);
+        // Skip all buckets with too small indegrees
+        auto it(std::lower_bound(buckets.begin(), buckets.end(), inBucket, [](const Bucket& b, const unsigned value) -> bool { return b.in < value; }));
+        for (; it != buckets.end(); it++)
+        {
+            if (it->out < outBucket)
+                continue;
+            // NOTE: Only the lowest buckets can contain hedges with too small degrees
+            const bool exact((it->in == inBucket) || (it->out == outBucket));
+            for (const Handle h : it->hedges)
+            {
+                if (exact ? !accept(h) : !covers(h, next, previous))
+                    continue;
+                if (filter && !filter(h))
+                    continue;
+                result.push_back(h);
+            }
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return _data.ids(result);
+}
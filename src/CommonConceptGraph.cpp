@@ -1,5 +1,8 @@
 #include "CommonConceptGraph.hpp"
 #include <iostream>
+#include <set>
+#include <unordered_map>
+#include <algorithm>
 
 const UniqueId CommonConceptGraph::FactOfId = "CommonConceptGraph::FactOf";
 const UniqueId CommonConceptGraph::SubrelOfId = "CommonConceptGraph::SubrelOf";
@@ -409,7 +412,9 @@ Hyperedges CommonConceptGraph::transitivelyRelatedTo(const Hyperedges& conceptUi
 {
     // At first, find all relations we have to consider during traversal:
     // These are all subrelations of relId including relId itself
-    const Hyperedges& relationsToFollow(subrelationsOf(relationUids));
+    // Then, collect all facts r <- FACT-OF -> R where R is element of these relations once (instead of once per visited relation)
+    const Hyperedges& factsToFollow(transitiveFactsOf(relationUids));
+    const std::set< UniqueId > factsToFollowSet(factsToFollow.begin(), factsToFollow.end());
 
     // The filter function is like the one in subrelationsOf
     auto cf = [&](const Conceptgraph& cg, const UniqueId& c, const Hyperedges& p) -> bool {
@@ -418,60 +423,275 @@ Hyperedges CommonConceptGraph::transitivelyRelatedTo(const Hyperedges& conceptUi
         return false;
     };
 
-    // For the relation filter function, we have to check that
-    // r <- FACT-OF -> R where R is element of relationsToFollow
+    // For the relation filter function, we have to check that r is one of the facts to follow
     auto rf = [&](const Conceptgraph& cg, const UniqueId& c, const UniqueId& r) -> bool {
-        const Hyperedges& toSearch(cg.isPointingTo(cg.relationsFrom(Hyperedges{r}, cg.access(CommonConceptGraph::FactOfId).label())));
-        if (intersect(toSearch, relationsToFollow).empty())
-            return false;
-        return true;
+        return factsToFollowSet.count(r) > 0;
     };
 
-    // For each given concept, start a graph traversal with the defined filter functions
+    // A single graph traversal starting at all given concepts (sharing one visited set)
+    return Conceptgraph::traverse(conceptUids, cf, rf, dir);
+}
+
+HyperedgeLists CommonConceptGraph::transitivelyRelatedToEach(const Hyperedges& conceptUids, const Hyperedges& relationUids, const std::string& label, const TraversalDirection dir) const
+{
+    // Same filters as in transitivelyRelatedTo, but we want to know which concept reached which hedges
+    const Hyperedges& factsToFollow(transitiveFactsOf(relationUids));
+    const std::set< UniqueId > factsToFollowSet(factsToFollow.begin(), factsToFollow.end());
+
+    auto cf = [&](const Conceptgraph& cg, const UniqueId& c, const Hyperedges& p) -> bool {
+        if (label.empty() || (cg.access(c).label() == label))
+            return true;
+        return false;
+    };
+    auto rf = [&](const Conceptgraph& cg, const UniqueId& c, const UniqueId& r) -> bool {
+        return factsToFollowSet.count(r) > 0;
+    };
+    return Conceptgraph::traverseEach(conceptUids, cf, rf, dir);
+}
+
+Hyperedges CommonConceptGraph::transitiveFactsOf(const Hyperedges& relationUids) const
+{
     Hyperedges result;
-    for (const UniqueId& c : conceptUids)
+    // The relations to consider are the given ones and all their subrelations
+    const Hyperedges& relationsToFollow(subrelationsOf(relationUids));
+    const std::set< UniqueId > relationSet(relationsToFollow.begin(), relationsToFollow.end());
+
+    // Single pass over all fact <- FACT-OF -> relation hedges
+    std::set< UniqueId > factsSeen;
+    for (const UniqueId& factOfUid : access(CommonConceptGraph::FactOfId).pointingFrom())
+    {
+        const Hyperedge& factOf(access(factOfUid));
+        bool relevant(false);
+        for (const UniqueId& superRelUid : factOf.pointingTo())
+        {
+            if (relationSet.count(superRelUid))
+                relevant = true;
+        }
+        if (!relevant)
+            continue;
+        for (const UniqueId& factUid : factOf.pointingFrom())
+        {
+            if (factsSeen.insert(factUid).second)
+                result.push_back(factUid);
+        }
+    }
+    return result;
+}
+
+Hypergraph CommonConceptGraph::factGraphOf(const Hyperedges& relationUids) const
+{
+    // Every fact a <- R -> b becomes a direct a -> b
+    Hypergraph result;
+    for (const UniqueId& factUid : transitiveFactsOf(relationUids))
+    {
+        const Hyperedge& fact(access(factUid));
+        for (const UniqueId& uid : unite(fact.pointingFrom(), fact.pointingTo()))
+            result.create(uid, access(uid).label());
+        result.pointsTo(fact.pointingFrom(), fact.pointingTo());
+    }
+    return result;
+}
+
+CommonConceptGraph::RelationSet CommonConceptGraph::localSubrelationsOf(const UniqueId& superRelUid) const
+{
+    // Follow X <- SUBREL-OF-fact -> Y backwards starting at superRelUid by looking at the relations pointing to each Y
+    RelationSet result{superRelUid};
+    Hyperedges frontier{superRelUid};
+    const RelationSet subrelOf{CommonConceptGraph::SubrelOfId};
+    for (unsigned i = 0; i < frontier.size(); i++)
+    {
+        // NOTE: We copy the id here, because frontier grows while we are iterating
+        const UniqueId current(frontier[i]);
+        for (const UniqueId& relUid : access(current)._toOthers)
+        {
+            if (!exists(relUid) || !access(relUid).isPointingTo(current) || !isFactOfAny(relUid, subrelOf))
+                continue;
+            for (const UniqueId& subRelUid : access(relUid).pointingFrom())
+            {
+                if (result.insert(subRelUid).second)
+                    frontier.push_back(subRelUid);
+            }
+        }
+    }
+    return result;
+}
+
+bool CommonConceptGraph::isFactOfAny(const UniqueId& factUid, const RelationSet& superRelUids) const
+{
+    // A fact is pointed from by a FACT-OF hedge which points to the super relation
+    // The FACT-OF hedges themselves are pointed from by FactOfId. Since FactOfId points from ALL of them, we look at the cache of the FACT-OF hedge instead.
+    // NOTE: The caches may contain stale entries (e.g. of destroyed hedges), so the wiring of the fact itself has to be checked
+    const bool single(superRelUids.size() == 1);
+    for (const UniqueId& factOfUid : access(factUid)._fromOthers)
+    {
+        if (!exists(factOfUid))
+            continue;
+        const Hyperedge& factOf(access(factOfUid));
+        if (!factOf.isPointingFrom(factUid))
+            continue;
+        if (std::find(factOf._fromOthers.begin(), factOf._fromOthers.end(), CommonConceptGraph::FactOfId) == factOf._fromOthers.end())
+            continue;
+        for (const UniqueId& superRelUid : factOf.pointingTo())
+        {
+            // Most relations have no subrelations: Then a single comparison suffices
+            if (single ? (superRelUid == *superRelUids.begin()) : (superRelUids.count(superRelUid) > 0))
+                return true;
+        }
+    }
+    return false;
+}
+
+Hyperedges CommonConceptGraph::relatedVia(const Hyperedges& conceptUids, const RelationSet& superRelUids, const std::string& label, const TraversalDirection dir) const
+{
+    Hyperedges result;
+    std::set< UniqueId > found;
+    auto collect = [&](const Hyperedges& uids) {
+        for (const UniqueId& uid : uids)
+        {
+            if (!label.empty() && (access(uid).label() != label))
+                continue;
+            if (found.insert(uid).second)
+                result.push_back(uid);
+        }
+    };
+    for (const UniqueId& conceptUid : conceptUids)
+    {
+        const Hyperedge& concept(access(conceptUid));
+        // INVERSE: Facts pointing to the concept lead to the hedges they point from
+        if ((dir == INVERSE) || (dir == BOTH))
+        {
+            for (const UniqueId& factUid : concept._toOthers)
+            {
+                if (exists(factUid) && access(factUid).isPointingTo(conceptUid) && isFactOfAny(factUid, superRelUids))
+                    collect(access(factUid).pointingFrom());
+            }
+        }
+        // FORWARD: Facts pointing from the concept lead to the hedges they point to
+        if ((dir == FORWARD) || (dir == BOTH))
+        {
+            for (const UniqueId& factUid : concept._fromOthers)
+            {
+                if (exists(factUid) && access(factUid).isPointingFrom(conceptUid) && isFactOfAny(factUid, superRelUids))
+                    collect(access(factUid).pointingTo());
+            }
+        }
+    }
+    return result;
+}
+
+HyperedgeLists CommonConceptGraph::topologicalOrderOf(const Hyperedges& relationUids, Hyperedges& cyclicUids, const TraversalDirection dir) const
+{
+    HyperedgeLists result;
+    cyclicUids.clear();
+
+    // Collect the dependencies between the hedges related by the facts
+    std::unordered_map< UniqueId, unsigned > numberOf;
+    Hyperedges uids;
+    std::vector< std::vector< unsigned > > successors;
+    auto number = [&](const UniqueId& uid) -> unsigned {
+        auto it(numberOf.find(uid));
+        if (it != numberOf.end())
+            return it->second;
+        numberOf[uid] = uids.size();
+        uids.push_back(uid);
+        successors.push_back(std::vector< unsigned >());
+        return uids.size() - 1;
+    };
+    for (const UniqueId& factUid : transitiveFactsOf(relationUids))
+    {
+        const Hyperedges& firsts(dir == INVERSE ? access(factUid).pointingTo() : access(factUid).pointingFrom());
+        const Hyperedges& seconds(dir == INVERSE ? access(factUid).pointingFrom() : access(factUid).pointingTo());
+        for (const UniqueId& firstUid : firsts)
+        {
+            const unsigned first(number(firstUid));
+            for (const UniqueId& secondUid : seconds)
+            {
+                const unsigned second(number(secondUid));
+                successors[first].push_back(second);
+            }
+        }
+    }
+
+    // Kahn's algorithm, level by level
+    std::vector< unsigned > pending(uids.size(), 0);
+    for (const auto& succs : successors)
+    {
+        for (const unsigned second : succs)
+            pending[second]++;
+    }
+    std::vector< unsigned > level;
+    for (unsigned i = 0; i < uids.size(); i++)
+    {
+        if (!pending[i])
+            level.push_back(i);
+    }
+    std::vector< bool > ordered(uids.size(), false);
+    while (!level.empty())
+    {
+        Hyperedges levelUids;
+        std::vector< unsigned > nextLevel;
+        for (const unsigned i : level)
+        {
+            ordered[i] = true;
+            levelUids.push_back(uids[i]);
+            for (const unsigned second : successors[i])
+            {
+                if (!--pending[second])
+                    nextLevel.push_back(second);
+            }
+        }
+        // Sorting keeps the levels independent of the order of the facts
+        std::sort(levelUids.begin(), levelUids.end());
+        result.append(levelUids);
+        level.swap(nextLevel);
+    }
+
+    // Everything left over is part of or depends on a cycle
+    for (unsigned i = 0; i < uids.size(); i++)
     {
-        result = unite(result, Conceptgraph::traverse(c, cf, rf, dir));
+        if (!ordered[i])
+            cyclicUids.push_back(uids[i]);
     }
+    std::sort(cyclicUids.begin(), cyclicUids.end());
     return result;
 }
 
 Hyperedges CommonConceptGraph::subclassesOf(const Hyperedges& superIds, const std::string& label, const TraversalDirection dir) const
 {
-    return transitivelyRelatedTo(superIds, Hyperedges{CommonConceptGraph::IsAId}, label, dir);
+    return transitivelyRelatedTo<Rel::IsA>(superIds, label, dir);
 }
 
 Hyperedges CommonConceptGraph::partsOf(const Hyperedges& wholeIds, const std::string& label, const TraversalDirection dir) const
 {
-    return transitivelyRelatedTo(wholeIds, Hyperedges{CommonConceptGraph::PartOfId}, label, dir);
+    return transitivelyRelatedTo<Rel::PartOf>(wholeIds, label, dir);
 }
 
 Hyperedges CommonConceptGraph::descendantsOf(const Hyperedges& ancestorIds, const std::string& label, const TraversalDirection dir) const
 {
-    return transitivelyRelatedTo(ancestorIds, Hyperedges{CommonConceptGraph::HasAId}, label, dir);
+    return transitivelyRelatedTo<Rel::HasA>(ancestorIds, label, dir);
 }
 
 Hyperedges CommonConceptGraph::directSubclassesOf(const Hyperedges& ids, const std::string& label, const TraversalDirection dir) const
 {
-    return relatedTo(ids, Hyperedges{CommonConceptGraph::IsAId}, label, dir);
+    return relatedTo<Rel::IsA>(ids, label, dir);
 }
 
 Hyperedges CommonConceptGraph::instancesOf(const Hyperedges& ids, const std::string& label, const TraversalDirection dir) const
 {
-    return relatedTo(ids, Hyperedges{CommonConceptGraph::InstanceOfId}, label, dir);
+    return relatedTo<Rel::InstanceOf>(ids, label, dir);
 }
 
 Hyperedges CommonConceptGraph::componentsOf(const Hyperedges& ids, const std::string& label, const TraversalDirection dir) const
 {
-    return relatedTo(ids, Hyperedges{CommonConceptGraph::PartOfId}, label, dir);
+    return relatedTo<Rel::PartOf>(ids, label, dir);
 }
 
 Hyperedges CommonConceptGraph::childrenOf(const Hyperedges& ids, const std::string& label, const TraversalDirection dir) const
 {
-    return relatedTo(ids, Hyperedges{CommonConceptGraph::HasAId}, label, dir);
+    return relatedTo<Rel::HasA>(ids, label, dir);
 }
 
 Hyperedges CommonConceptGraph::endpointsOf(const Hyperedges& ids, const std::string& label, const TraversalDirection dir) const
 {
-    return relatedTo(ids, Hyperedges{CommonConceptGraph::ConnectsId}, label, dir);
+    return relatedTo<Rel::Connects>(ids, label, dir);
 }
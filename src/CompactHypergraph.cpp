@@ -0,0 +1,739 @@
+#include "CompactHypergraph.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <utility>
+#include <cmath>
+#include <random>
+#include <unordered_set>
+#include <queue>
+
+const Handle CompactHypergraph::Invalid = UINT_MAX;
+
+// Builds CSR rows from a list of (row, value) pairs. If unique is set, every row is sorted and duplicates are removed.
+static void buildRows(const unsigned rows, const std::vector< std::pair< Handle, Handle > >& pairs, const bool unique,
+                      std::vector< unsigned >& offsets, std::vector< Handle >& values)
+{
+    // Counting sort by row (this keeps the original order of the values within a row)
+    offsets.assign(rows + 1, 0);
+    for (const auto& pair : pairs)
+        offsets[pair.first + 1]++;
+    for (unsigned r = 0; r < rows; r++)
+        offsets[r + 1] += offsets[r];
+    values.resize(pairs.size());
+    std::vector< unsigned > fill(offsets.begin(), offsets.end() - 1);
+    for (const auto& pair : pairs)
+        values[fill[pair.first]++] = pair.second;
+    if (!unique)
+        return;
+
+    // Sort each row, remove duplicates and compact the array
+    unsigned write = 0;
+    for (unsigned r = 0; r < rows; r++)
+    {
+        const unsigned first(offsets[r]);
+        const unsigned last(offsets[r + 1]);
+        std::sort(values.begin() + first, values.begin() + last);
+        const unsigned rowFirst(write);
+        for (unsigned i = first; i < last; i++)
+        {
+            if ((write > rowFirst) && (values[write - 1] == values[i]))
+                continue;
+            values[write++] = values[i];
+        }
+        offsets[r] = rowFirst;
+    }
+    offsets[rows] = write;
+    values.resize(write);
+}
+
+// Renumbers arbitrary component representatives to 0,1,... in the order of their smallest handle
+static std::vector< unsigned > canonical(const std::vector< unsigned >& representativeOf)
+{
+    std::vector< unsigned > result(representativeOf.size());
+    std::unordered_map< unsigned, unsigned > numberOf;
+    for (unsigned h = 0; h < representativeOf.size(); h++)
+    {
+        auto it(numberOf.find(representativeOf[h]));
+        if (it == numberOf.end())
+            it = numberOf.insert({representativeOf[h], numberOf.size()}).first;
+        result[h] = it->second;
+    }
+    return result;
+}
+
+CompactHypergraph::CompactHypergraph(const Hypergraph& graph)
+: _ids(graph.findByLabel())
+{
+    // Sorting the ids makes the handles independent of the hashing order of the hypergraph
+    std::sort(_ids.begin(), _ids.end());
+    const unsigned n(_ids.size());
+    _handles.reserve(n);
+    _labels.resize(n);
+    for (Handle h = 0; h < n; h++)
+    {
+        _handles[_ids[h]] = h;
+        const std::string& name(graph.access(_ids[h]).label());
+        auto it(_labelNumbers.find(name));
+        if (it == _labelNumbers.end())
+        {
+            it = _labelNumbers.insert({name, _labelNames.size()}).first;
+            _labelNames.push_back(name);
+        }
+        _labels[h] = it->second;
+    }
+
+    // Translate the incidence information and derive the arcs h -> next
+    std::vector< std::pair< Handle, Handle > > to;
+    std::vector< std::pair< Handle, Handle > > from;
+    std::vector< std::pair< Handle, Handle > > arcs;
+    std::vector< std::pair< Handle, Handle > > inverseArcs;
+    for (Handle h = 0; h < n; h++)
+    {
+        const Hyperedge& edge(graph.access(_ids[h]));
+        for (const UniqueId& toId : edge.pointingTo())
+        {
+            const Handle other(handle(toId));
+            if (other == Invalid)
+                continue;
+            to.push_back({h, other});
+            arcs.push_back({h, other});
+            inverseArcs.push_back({other, h});
+        }
+        for (const UniqueId& fromId : edge.pointingFrom())
+        {
+            const Handle other(handle(fromId));
+            if (other == Invalid)
+                continue;
+            from.push_back({h, other});
+            arcs.push_back({other, h});
+            inverseArcs.push_back({h, other});
+        }
+    }
+    buildRows(n, to, false, _toOffsets, _to);
+    buildRows(n, from, false, _fromOffsets, _from);
+    buildRows(n, arcs, true, _nextOffsets, _next);
+    buildRows(n, inverseArcs, true, _prevOffsets, _prev);
+    arcs.insert(arcs.end(), inverseArcs.begin(), inverseArcs.end());
+    buildRows(n, arcs, true, _allOffsets, _all);
+}
+
+Handle CompactHypergraph::handle(const UniqueId& id) const
+{
+    auto it(_handles.find(id));
+    if (it == _handles.end())
+        return Invalid;
+    return it->second;
+}
+
+unsigned CompactHypergraph::labelOf(const std::string& name) const
+{
+    auto it(_labelNumbers.find(name));
+    if (it == _labelNumbers.end())
+        return Invalid;
+    return it->second;
+}
+
+Hyperedges CompactHypergraph::ids(const std::vector< Handle >& handles) const
+{
+    Hyperedges result;
+    result.reserve(handles.size());
+    for (const Handle h : handles)
+        result.push_back(_ids[h]);
+    return result;
+}
+
+std::vector< Handle > CompactHypergraph::handles(const Hyperedges& ids) const
+{
+    std::vector< Handle > result;
+    result.reserve(ids.size());
+    for (const UniqueId& id : ids)
+    {
+        const Handle h(handle(id));
+        if (h != Invalid)
+            result.push_back(h);
+    }
+    return result;
+}
+
+SparseMatrix CompactHypergraph::csr(const MatrixType type) const
+{
+    const unsigned n(size());
+    SparseMatrix result(n, n);
+    for (Handle h = 0; h < n; h++)
+    {
+        HandleRange range;
+        switch (type)
+        {
+            case POINTING_TO:
+                range = pointingTo(h);
+                break;
+            case POINTING_FROM:
+                range = pointingFrom(h);
+                break;
+            default:
+                range = next(h);
+                break;
+        }
+        // The incidence rows keep the original order and may contain duplicates, so we sort them and count the duplicates
+        std::vector< Handle > columns(range.begin(), range.end());
+        std::sort(columns.begin(), columns.end());
+        for (unsigned i = 0; i < columns.size(); i++)
+        {
+            if (i && (columns[i] == columns[i - 1]))
+            {
+                result.values.back()++;
+                continue;
+            }
+            result.indices.push_back(columns[i]);
+            result.values.push_back(1);
+        }
+        result.offsets[h + 1] = result.indices.size();
+    }
+    return result;
+}
+
+SparseMatrix CompactHypergraph::csc(const MatrixType type) const
+{
+    return csr(type).transposed();
+}
+
+CoordinateMatrix CompactHypergraph::coo(const MatrixType type) const
+{
+    return toCoordinates(csr(type));
+}
+
+SparseMatrix CompactHypergraph::bipartite() const
+{
+    const unsigned n(size());
+    SparseMatrix result(n, n);
+    std::vector< Handle > members;
+    for (Handle h = 0; h < n; h++)
+    {
+        members.assign(pointingFrom(h).begin(), pointingFrom(h).end());
+        members.insert(members.end(), pointingTo(h).begin(), pointingTo(h).end());
+        std::sort(members.begin(), members.end());
+        for (unsigned i = 0; i < members.size(); i++)
+        {
+            if (i && (members[i] == members[i - 1]))
+            {
+                result.values.back()++;
+                continue;
+            }
+            result.indices.push_back(members[i]);
+            result.values.push_back(1);
+        }
+        result.offsets[h + 1] = result.indices.size();
+    }
+    return result;
+}
+
+SparseMatrix CompactHypergraph::cliqueExpansion(const bool weighted) const
+{
+    // The rows are streamed in order, so we can just append them
+    SparseMatrix result(size(), size());
+    Handle current = 0;
+    cliqueExpansion([&](const Handle a, const Handle b, const unsigned weight) {
+        while (current < a)
+            result.offsets[++current] = result.indices.size();
+        result.indices.push_back(b);
+        result.values.push_back(weight);
+    }, weighted);
+    while (current < size())
+        result.offsets[++current] = result.indices.size();
+    return result;
+}
+
+std::vector< unsigned > CompactHypergraph::weaklyConnectedComponents() const
+{
+    // Union-find with path halving and union by size
+    const unsigned n(size());
+    std::vector< unsigned > parent(n);
+    std::vector< unsigned > weight(n, 1);
+    for (Handle h = 0; h < n; h++)
+        parent[h] = h;
+    auto find = [&](unsigned x) -> unsigned {
+        while (parent[x] != x)
+        {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    };
+    for (Handle h = 0; h < n; h++)
+    {
+        for (const Handle other : next(h))
+        {
+            unsigned a(find(h));
+            unsigned b(find(other));
+            if (a == b)
+                continue;
+            if (weight[a] < weight[b])
+                std::swap(a, b);
+            parent[b] = a;
+            weight[a] += weight[b];
+        }
+    }
+    for (Handle h = 0; h < n; h++)
+        parent[h] = find(h);
+    return canonical(parent);
+}
+
+std::vector< unsigned > CompactHypergraph::stronglyConnectedComponents() const
+{
+    // Tarjan's algorithm with an explicit call stack (deep hierarchies would overflow the real one)
+    const unsigned n(size());
+    const unsigned unvisited(UINT_MAX);
+    std::vector< unsigned > index(n, unvisited);
+    std::vector< unsigned > lowlink(n, 0);
+    std::vector< bool > onStack(n, false);
+    std::vector< Handle > stack;
+    std::vector< std::pair< Handle, unsigned > > calls;     // (hedge, position in its next row)
+    std::vector< unsigned > representativeOf(n, 0);
+    unsigned counter = 0;
+
+    for (Handle root = 0; root < n; root++)
+    {
+        if (index[root] != unvisited)
+            continue;
+        index[root] = lowlink[root] = counter++;
+        stack.push_back(root);
+        onStack[root] = true;
+        calls.push_back({root, 0});
+        while (!calls.empty())
+        {
+            const Handle v(calls.back().first);
+            const HandleRange successors(next(v));
+            if (calls.back().second < successors.size())
+            {
+                const Handle w(successors.first[calls.back().second++]);
+                if (index[w] == unvisited)
+                {
+                    // Descend
+                    index[w] = lowlink[w] = counter++;
+                    stack.push_back(w);
+                    onStack[w] = true;
+                    calls.push_back({w, 0});
+                } else if (onStack[w]) {
+                    lowlink[v] = std::min(lowlink[v], index[w]);
+                }
+                continue;
+            }
+            // All successors done: return to the caller
+            calls.pop_back();
+            if (!calls.empty())
+            {
+                const Handle u(calls.back().first);
+                lowlink[u] = std::min(lowlink[u], lowlink[v]);
+            }
+            if (lowlink[v] != index[v])
+                continue;
+            // v is the root of a component
+            Handle w;
+            do
+            {
+                w = stack.back();
+                stack.pop_back();
+                onStack[w] = false;
+                representativeOf[w] = v;
+            }
+            while (w != v);
+        }
+    }
+    return canonical(representativeOf);
+}
+
+std::vector< unsigned > CompactHypergraph::labelPropagationComponents(const unsigned threads) const
+{
+    // Every hedge starts with its own handle and takes over the minimum of its neighbours until nothing changes.
+    // Reading current and writing updated keeps the threads independent of each other.
+    const unsigned n(size());
+    const unsigned workers(threadCount(threads));
+    std::vector< unsigned > current(n);
+    std::vector< unsigned > updated(n);
+    for (Handle h = 0; h < n; h++)
+        current[h] = h;
+    std::vector< char > changed(workers, 1);
+    while (std::find(changed.begin(), changed.end(), 1) != changed.end())
+    {
+        std::fill(changed.begin(), changed.end(), 0);
+        parallelFor(0, n, workers, [&](const unsigned first, const unsigned last, const unsigned t) {
+            for (Handle h = first; h < last; h++)
+            {
+                unsigned best(current[h]);
+                for (const Handle other : next(h))
+                    best = std::min(best, current[other]);
+                for (const Handle other : previous(h))
+                    best = std::min(best, current[other]);
+                // Pointer jumping: adopt the label of our label as well (speeds up long chains)
+                best = std::min(best, current[best]);
+                if (best != current[h])
+                    changed[t] = 1;
+                updated[h] = best;
+            }
+        });
+        current.swap(updated);
+    }
+    return canonical(current);
+}
+
+HyperedgeLists CompactHypergraph::groups(const std::vector< unsigned >& componentOf) const
+{
+    HyperedgeLists result;
+    unsigned count = 0;
+    for (const unsigned c : componentOf)
+        count = std::max(count, c + 1);
+    std::vector< unsigned > offsets(count + 1, 0);
+    for (const unsigned c : componentOf)
+        offsets[c + 1]++;
+    for (unsigned c = 0; c < count; c++)
+        offsets[c + 1] += offsets[c];
+    result.offsets = offsets;
+    result.ids.resize(componentOf.size());
+    for (Handle h = 0; h < componentOf.size(); h++)
+        result.ids[offsets[componentOf[h]]++] = _ids[h];
+    return result;
+}
+
+std::vector< unsigned > CompactHypergraph::degreeHistogram(const Hypergraph::TraversalDirection dir, const unsigned threads) const
+{
+    // Every thread fills its own histogram, afterwards they get summed up
+    const unsigned n(size());
+    const unsigned workers(threadCount(threads));
+    std::vector< std::vector< unsigned > > partial(workers);
+    parallelFor(0, n, workers, [&](const unsigned first, const unsigned last, const unsigned t) {
+        std::vector< unsigned >& histogram(partial[t]);
+        for (Handle h = first; h < last; h++)
+        {
+            unsigned degree;
+            switch (dir)
+            {
+                case Hypergraph::FORWARD:
+                    degree = next(h).size();
+                    break;
+                case Hypergraph::INVERSE:
+                    degree = previous(h).size();
+                    break;
+                default:
+                    degree = neighbours(h).size();
+                    break;
+            }
+            if (degree >= histogram.size())
+                histogram.resize(degree + 1, 0);
+            histogram[degree]++;
+        }
+    });
+    std::vector< unsigned > result;
+    for (const auto& histogram : partial)
+    {
+        if (histogram.size() > result.size())
+            result.resize(histogram.size(), 0);
+        for (unsigned d = 0; d < histogram.size(); d++)
+            result[d] += histogram[d];
+    }
+    return result;
+}
+
+std::vector< double > CompactHypergraph::pageRank(const double damping, const unsigned maxIterations, const double tolerance, const unsigned threads) const
+{
+    // Pull based power iteration: Each hedge sums up the contributions of its predecessors.
+    // The rank of hedges without successors (dangling) is spread uniformly.
+    const unsigned n(size());
+    if (!n)
+        return std::vector< double >();
+    const unsigned workers(threadCount(threads));
+    std::vector< double > rank(n, 1.0 / n);
+    std::vector< double > updated(n, 0.0);
+    std::vector< double > contribution(n, 0.0);
+    std::vector< double > partialDangling(workers, 0.0);
+    std::vector< double > partialDelta(workers, 0.0);
+
+    for (unsigned iteration = 0; iteration < maxIterations; iteration++)
+    {
+        std::fill(partialDangling.begin(), partialDangling.end(), 0.0);
+        std::fill(partialDelta.begin(), partialDelta.end(), 0.0);
+        parallelFor(0, n, workers, [&](const unsigned first, const unsigned last, const unsigned t) {
+            for (Handle h = first; h < last; h++)
+            {
+                const unsigned outdegree(next(h).size());
+                if (outdegree)
+                {
+                    contribution[h] = rank[h] / outdegree;
+                } else {
+                    contribution[h] = 0.0;
+                    partialDangling[t] += rank[h];
+                }
+            }
+        });
+        double dangling = 0.0;
+        for (const double d : partialDangling)
+            dangling += d;
+        const double base((1.0 - damping) / n + damping * dangling / n);
+        parallelFor(0, n, workers, [&](const unsigned first, const unsigned last, const unsigned t) {
+            for (Handle h = first; h < last; h++)
+            {
+                double sum = 0.0;
+                for (const Handle other : previous(h))
+                    sum += contribution[other];
+                updated[h] = base + damping * sum;
+                partialDelta[t] += std::fabs(updated[h] - rank[h]);
+            }
+        });
+        rank.swap(updated);
+        double delta = 0.0;
+        for (const double d : partialDelta)
+            delta += d;
+        if (delta < tolerance)
+            break;
+    }
+    return rank;
+}
+
+std::vector< unsigned > CompactHypergraph::coreNumbers() const
+{
+    // Batagelj & Zaversnik: process hedges in order of their current degree using bucket sort, O(n + m)
+    const unsigned n(size());
+    std::vector< unsigned > degree(n, 0);
+    unsigned maxDegree = 0;
+    for (Handle h = 0; h < n; h++)
+    {
+        for (const Handle other : neighbours(h))
+        {
+            if (other != h)
+                degree[h]++;
+        }
+        maxDegree = std::max(maxDegree, degree[h]);
+    }
+    // bucketStart[d] is the position of the first hedge with degree d in order
+    std::vector< unsigned > bucketStart(maxDegree + 2, 0);
+    for (Handle h = 0; h < n; h++)
+        bucketStart[degree[h] + 1]++;
+    for (unsigned d = 0; d <= maxDegree; d++)
+        bucketStart[d + 1] += bucketStart[d];
+    std::vector< Handle > order(n);
+    std::vector< unsigned > position(n);
+    {
+        std::vector< unsigned > fill(bucketStart.begin(), bucketStart.end() - 1);
+        for (Handle h = 0; h < n; h++)
+        {
+            position[h] = fill[degree[h]]++;
+            order[position[h]] = h;
+        }
+    }
+    for (unsigned i = 0; i < n; i++)
+    {
+        const Handle h(order[i]);
+        for (const Handle other : neighbours(h))
+        {
+            if ((other == h) || (degree[other] <= degree[h]))
+                continue;
+            // Move other to the front of its bucket and shrink the bucket
+            const unsigned d(degree[other]);
+            const unsigned swapPosition(bucketStart[d]);
+            const Handle swapHandle(order[swapPosition]);
+            if (swapHandle != other)
+            {
+                std::swap(order[position[other]], order[swapPosition]);
+                position[swapHandle] = position[other];
+                position[other] = swapPosition;
+            }
+            bucketStart[d]++;
+            degree[other]--;
+        }
+    }
+    return degree;
+}
+
+unsigned long long CompactHypergraph::triangles(std::vector< unsigned >& perHedge, const unsigned threads) const
+{
+    // Orient every undirected edge from the lower to the higher ranked end (rank: degree, then handle).
+    // Then every triangle a < b < c is found exactly once by intersecting the oriented lists of a and b.
+    // Since the oriented lists are short for high degree hedges, hubs do not dominate the costs.
+    const unsigned n(size());
+    const unsigned workers(threadCount(threads));
+    auto lower = [&](const Handle a, const Handle b) -> bool {
+        const unsigned degreeA(neighbours(a).size());
+        const unsigned degreeB(neighbours(b).size());
+        return (degreeA < degreeB) || ((degreeA == degreeB) && (a < b));
+    };
+    std::vector< unsigned > offsets(n + 1, 0);
+    std::vector< Handle > higher;
+    for (Handle h = 0; h < n; h++)
+    {
+        // neighbours() is sorted by handle, so the oriented lists are sorted as well
+        for (const Handle other : neighbours(h))
+        {
+            if ((other != h) && lower(h, other))
+                higher.push_back(other);
+        }
+        offsets[h + 1] = higher.size();
+    }
+
+    std::vector< std::vector< unsigned > > partialPerHedge(workers, std::vector< unsigned >(n, 0));
+    std::vector< unsigned long long > partialTotal(workers, 0);
+    parallelFor(0, n, workers, [&](const unsigned first, const unsigned last, const unsigned t) {
+        std::vector< unsigned >& counts(partialPerHedge[t]);
+        for (Handle a = first; a < last; a++)
+        {
+            for (unsigned i = offsets[a]; i < offsets[a + 1]; i++)
+            {
+                const Handle b(higher[i]);
+                // Sorted intersection of the oriented lists of a and b
+                unsigned x(offsets[a]), y(offsets[b]);
+                while ((x < offsets[a + 1]) && (y < offsets[b + 1]))
+                {
+                    if (higher[x] < higher[y])
+                    {
+                        x++;
+                    } else if (higher[y] < higher[x]) {
+                        y++;
+                    } else {
+                        counts[a]++;
+                        counts[b]++;
+                        counts[higher[x]]++;
+                        partialTotal[t]++;
+                        x++;
+                        y++;
+                    }
+                }
+            }
+        }
+    });
+
+    perHedge.assign(n, 0);
+    unsigned long long total = 0;
+    for (unsigned t = 0; t < workers; t++)
+    {
+        total += partialTotal[t];
+        for (Handle h = 0; h < n; h++)
+            perHedge[h] += partialPerHedge[t][h];
+    }
+    return total;
+}
+
+unsigned long long CompactHypergraph::wedges(std::vector< unsigned long long >& perHedge, const Hypergraph::TraversalDirection dir) const
+{
+    const unsigned n(size());
+    perHedge.assign(n, 0);
+    unsigned long long total = 0;
+    for (Handle h = 0; h < n; h++)
+    {
+        // Self loops do not count as a second hedge
+        const HandleRange range(dir == Hypergraph::INVERSE ? previous(h) : next(h));
+        unsigned long long k(range.size());
+        if (std::binary_search(range.begin(), range.end(), h))
+            k--;
+        perHedge[h] = k ? k * (k - 1) / 2 : 0;
+        total += perHedge[h];
+    }
+    return total;
+}
+
+// The standard distributions are implementation defined, so we derive our numbers directly from the engine to get the same samples everywhere
+static unsigned randomBelow(std::mt19937& rng, const unsigned n)
+{
+    return rng() % n;
+}
+
+static double randomUnit(std::mt19937& rng)
+{
+    return rng() / (double(std::mt19937::max()) + 1.0);
+}
+
+std::vector< Handle > CompactHypergraph::uniformSample(const unsigned count, const unsigned seed) const
+{
+    // Floyd's algorithm draws count distinct handles with O(count) work
+    const unsigned n(size());
+    const unsigned k(std::min(count, n));
+    std::mt19937 rng(seed);
+    std::unordered_set< Handle > chosen;
+    std::vector< Handle > result;
+    for (unsigned j = n - k; j < n; j++)
+    {
+        const Handle h(randomBelow(rng, j + 1));
+        if (chosen.insert(h).second)
+        {
+            result.push_back(h);
+        } else {
+            chosen.insert(j);
+            result.push_back(j);
+        }
+    }
+    return result;
+}
+
+std::vector< Handle > CompactHypergraph::randomWalkSample(const std::vector< Handle >& starts, const unsigned count, const double restart,
+                                                          const Hypergraph::TraversalDirection dir, const unsigned seed) const
+{
+    std::vector< Handle > result;
+    if (starts.empty())
+        return result;
+    std::mt19937 rng(seed);
+    std::vector< bool > sampled(size(), false);
+    // Bound the walk, otherwise a start in a small component would walk forever
+    const unsigned long long maxSteps(100ull * std::max(count, 1u));
+    Handle current(starts[randomBelow(rng, starts.size())]);
+    for (unsigned long long step = 0; (step < maxSteps) && (result.size() < count); step++)
+    {
+        if (!sampled[current])
+        {
+            sampled[current] = true;
+            result.push_back(current);
+        }
+        const HandleRange range(dir == Hypergraph::FORWARD ? next(current) : (dir == Hypergraph::INVERSE ? previous(current) : neighbours(current)));
+        if (range.empty() || (randomUnit(rng) < restart))
+        {
+            current = starts[randomBelow(rng, starts.size())];
+            continue;
+        }
+        current = range.first[randomBelow(rng, range.size())];
+    }
+    return result;
+}
+
+std::vector< Handle > CompactHypergraph::forestFireSample(const unsigned count, const double burn, const unsigned seed) const
+{
+    const unsigned n(size());
+    const unsigned k(std::min(count, n));
+    std::mt19937 rng(seed);
+    std::vector< bool > burnt(n, false);
+    std::vector< Handle > result;
+    std::queue< Handle > burning;
+    std::vector< Handle > candidates;
+    while (result.size() < k)
+    {
+        if (burning.empty())
+        {
+            // Ignite a new fire at a random, unburnt hedge
+            Handle h(randomBelow(rng, n));
+            while (burnt[h])
+                h = (h + 1) % n;
+            burnt[h] = true;
+            result.push_back(h);
+            burning.push(h);
+            continue;
+        }
+        const Handle current(burning.front());
+        burning.pop();
+        candidates.clear();
+        for (const Handle other : neighbours(current))
+        {
+            if (!burnt[other])
+                candidates.push_back(other);
+        }
+        // Draw the number of neighbours to burn from a geometric distribution (capped, so burn >= 1 burns all of them)
+        unsigned toBurn = 0;
+        while ((toBurn < candidates.size()) && (randomUnit(rng) < burn))
+            toBurn++;
+        for (unsigned i = 0; (i < toBurn) && (i < candidates.size()) && (result.size() < k); i++)
+        {
+            // Partial Fisher-Yates shuffle to pick distinct neighbours
+            std::swap(candidates[i], candidates[i + randomBelow(rng, candidates.size() - i)]);
+            burnt[candidates[i]] = true;
+            result.push_back(candidates[i]);
+            burning.push(candidates[i]);
+        }
+    }
+    return result;
+}
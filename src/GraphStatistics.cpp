@@ -0,0 +1,145 @@
+#include "GraphStatistics.hpp"
+#include "CompactHypergraph.hpp"
+
+#include <climits>
+#include <algorithm>
+
+// Returns the fraction of the entries of a histogram with at least the given degree
+static double fraction(const std::vector< unsigned >& histogram, const unsigned degree)
+{
+    unsigned long long total = 0;
+    unsigned long long above = 0;
+    for (unsigned d = 0; d < histogram.size(); d++)
+    {
+        total += histogram[d];
+        if (d >= degree)
+            above += histogram[d];
+    }
+    return total ? (double)above / total : 0.0;
+}
+
+GraphStatistics::GraphStatistics(const Hypergraph& data)
+{
+    const CompactHypergraph compact(data);
+    const unsigned labels(compact.labelCount());
+    _size = compact.size();
+    _ids.insert(compact.ids().begin(), compact.ids().end());
+    for (unsigned l = 0; l < labels; l++)
+        _labels[compact.labelName(l)] = l;
+    _cardinalities.assign(labels, 0);
+    for (unsigned dir = 0; dir < 3; dir++)
+        _histograms[dir].resize(labels);
+    _outgoing.assign(labels, 0);
+    _incoming.assign(labels, 0);
+
+    for (Handle h = 0; h < _size; h++)
+    {
+        const unsigned l(compact.label(h));
+        _cardinalities[l]++;
+        const unsigned degrees[3] = {compact.next(h).size(), compact.previous(h).size(), compact.neighbours(h).size()};
+        for (unsigned dir = 0; dir < 3; dir++)
+        {
+            std::vector< unsigned >& histogram(_histograms[dir][l]);
+            if (degrees[dir] >= histogram.size())
+                histogram.resize(degrees[dir] + 1, 0);
+            histogram[degrees[dir]]++;
+        }
+        for (const Handle other : compact.next(h))
+        {
+            const unsigned m(compact.label(other));
+            _cooccurrences[(unsigned long long)l * labels + m]++;
+            _outgoing[l]++;
+            _incoming[m]++;
+        }
+    }
+}
+
+unsigned GraphStatistics::labelOf(const std::string& label) const
+{
+    auto it(_labels.find(label));
+    return (it != _labels.end()) ? it->second : UINT_MAX;
+}
+
+unsigned GraphStatistics::cardinality(const std::string& label) const
+{
+    if (label.empty())
+        return _size;
+    const unsigned l(labelOf(label));
+    return (l != UINT_MAX) ? _cardinalities[l] : 0;
+}
+
+std::vector< unsigned > GraphStatistics::degreeHistogram(const std::string& label, const Hypergraph::TraversalDirection dir) const
+{
+    const std::vector< std::vector< unsigned > >& histograms(_histograms[dir]);
+    if (!label.empty())
+    {
+        const unsigned l(labelOf(label));
+        return (l != UINT_MAX) ? histograms[l] : std::vector< unsigned >();
+    }
+    // Sum up the histograms of all labels
+    std::vector< unsigned > result;
+    for (const std::vector< unsigned >& histogram : histograms)
+    {
+        if (histogram.size() > result.size())
+            result.resize(histogram.size(), 0);
+        for (unsigned d = 0; d < histogram.size(); d++)
+            result[d] += histogram[d];
+    }
+    return result;
+}
+
+unsigned long long GraphStatistics::cooccurrences(const std::string& from, const std::string& to) const
+{
+    const unsigned f(labelOf(from));
+    const unsigned t(labelOf(to));
+    if (from.empty() && to.empty())
+    {
+        unsigned long long total = 0;
+        for (const unsigned long long count : _outgoing)
+            total += count;
+        return total;
+    }
+    if (from.empty())
+        return (t != UINT_MAX) ? _incoming[t] : 0;
+    if (to.empty())
+        return (f != UINT_MAX) ? _outgoing[f] : 0;
+    if ((f == UINT_MAX) || (t == UINT_MAX))
+        return 0;
+    auto it(_cooccurrences.find((unsigned long long)f * _cardinalities.size() + t));
+    return (it != _cooccurrences.end()) ? it->second : 0;
+}
+
+double GraphStatistics::candidates(const Hypergraph& query, const UniqueId& queryId) const
+{
+    // A hedge found in the data graph can only be matched to itself
+    if (contains(queryId))
+        return 1.0;
+    const std::string& label(query.access(queryId).label());
+    const unsigned count(cardinality(label));
+    if (!count)
+        return 0.0;
+    // Assume the degrees to be independent of each other
+    Hyperedges next(query.nextNeighboursOf(Hyperedges{queryId}));
+    Hyperedges previous(query.previousNeighboursOf(Hyperedges{queryId}));
+    std::sort(next.begin(), next.end());
+    next.erase(std::unique(next.begin(), next.end()), next.end());
+    std::sort(previous.begin(), previous.end());
+    previous.erase(std::unique(previous.begin(), previous.end()), previous.end());
+    return count * fraction(degreeHistogram(label, Hypergraph::FORWARD), next.size()) * fraction(degreeHistogram(label, Hypergraph::INVERSE), previous.size());
+}
+
+double GraphStatistics::fanout(const std::string& from, const std::string& to, const Hypergraph::TraversalDirection dir) const
+{
+    const unsigned count(cardinality(from));
+    if (!count)
+        return 0.0;
+    switch (dir)
+    {
+        case Hypergraph::FORWARD:
+            return (double)cooccurrences(from, to) / count;
+        case Hypergraph::INVERSE:
+            return (double)cooccurrences(to, from) / count;
+        default:
+            return (double)(cooccurrences(from, to) + cooccurrences(to, from)) / count;
+    }
+}
@@ -140,3 +140,14 @@ std::ostream& operator<< (std::ostream& os , const Hyperedges& val)
     os << " ]";
     return os;
 }
+
+Hyperedges HyperedgeLists::at(const unsigned i) const
+{
+    return Hyperedges(ids.begin() + offsets.at(i), ids.begin() + offsets.at(i+1));
+}
+
+void HyperedgeLists::append(const Hyperedges& list)
+{
+    ids.insert(ids.end(), list.begin(), list.end());
+    offsets.push_back(ids.size());
+}
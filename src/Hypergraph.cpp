@@ -1,20 +1,47 @@
 #include "Hypergraph.hpp"
+#include "CompactHypergraph.hpp"
+#include "GraphStatistics.hpp"
 
 #include <iostream>
+#include <unordered_set>
+#include <algorithm>
+#include <climits>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <atomic>
+#include "Parallel.hpp"
 
 const UniqueId Hypergraph::Zero = "Hypergraph::Hyperedge::Zero";
 
+// Hands out the version stamps of all graphs
+static unsigned long long nextVersion()
+{
+    static std::atomic< unsigned long long > counter(0);
+    return ++counter;
+}
+
 Hypergraph::Hypergraph()
+: _log(nullptr), _version(nextVersion())
 {
     create(Zero, "ZERO");
 }
 
 Hypergraph::Hypergraph(const Hypergraph& other)
+: _log(nullptr), _version(nextVersion())
 {
     create(Zero, "ZERO");
     importFrom(other);
 }
 
+Hypergraph& Hypergraph::operator= (const Hypergraph& other)
+{
+    _edges = other._edges;
+    _version = nextVersion();
+    return *this;
+}
+
 Hypergraph::~Hypergraph()
 {
     // We hold no pointers so we do not need to do anything here
@@ -57,6 +84,9 @@ Hyperedges Hypergraph::create(const UniqueId id, const std::string& label, const
         // Create a new hyperedge
         // Give it the desired id
         _edges[id] = Hyperedge(id, label, props);
+        _version = nextVersion();
+        if (_log)
+            _log->push_back(Change{Change::CREATE, Hyperedges{id}, Hyperedges()});
         return Hyperedges{id};
     }
     return Hyperedges();
@@ -74,11 +104,45 @@ void Hypergraph::destroy(const UniqueId id)
     if (exists(id))
     {
         _edges.erase(id);
+        _version = nextVersion();
+        if (_log)
+            _log->push_back(Change{Change::DESTROY, Hyperedges{id}, Hyperedges()});
     }
 }
 
 void Hypergraph::disconnect(const UniqueId id)
 {
+    if (exists(id))
+        _version = nextVersion();
+    if (_log && exists(id))
+    {
+        // NOTE: The caches may contain stale entries (even of destroyed hedges), so we have to check them instead of using allNeighboursOf
+        const Hyperedge& hedge(_edges.at(id));
+        Hyperedges neighbours;
+        for (const UniqueId& otherId : hedge._to)
+        {
+            if ((otherId != Zero) && exists(otherId))
+                neighbours.push_back(otherId);
+        }
+        for (const UniqueId& otherId : hedge._from)
+        {
+            if ((otherId != Zero) && exists(otherId))
+                neighbours.push_back(otherId);
+        }
+        for (const UniqueId& otherId : hedge._toOthers)
+        {
+            if ((otherId != Zero) && exists(otherId) && _edges.at(otherId).isPointingTo(id))
+                neighbours.push_back(otherId);
+        }
+        for (const UniqueId& otherId : hedge._fromOthers)
+        {
+            if ((otherId != Zero) && exists(otherId) && _edges.at(otherId).isPointingFrom(id))
+                neighbours.push_back(otherId);
+        }
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        _log->push_back(Change{Change::DISCONNECT, Hyperedges{id}, neighbours});
+    }
     // We point to others and others might point to us
     // I. In all Hyperedges WE point to or from we have to cleanup the caches
     const Hyperedges& fromIds(access(id)._from);
@@ -174,6 +238,10 @@ Hyperedges Hypergraph::pointsFrom(const Hyperedges& destIds, const Hyperedges& o
             result = unite(result, Hyperedges{destId, otherId});
         }
     }
+    if (!result.empty())
+        _version = nextVersion();
+    if (_log && !result.empty())
+        _log->push_back(Change{Change::POINTS_FROM, destIds, otherIds});
     return result;
 }
 
@@ -222,6 +290,10 @@ Hyperedges Hypergraph::pointsTo(const Hyperedges& srcIds, const Hyperedges& othe
             result = unite(result, Hyperedges{srcId, otherId});
         }
     }
+    if (!result.empty())
+        _version = nextVersion();
+    if (_log && !result.empty())
+        _log->push_back(Change{Change::POINTS_TO, srcIds, otherIds});
     return result;
 }
 
@@ -297,74 +369,1760 @@ Hyperedges Hypergraph::allNeighboursOf(const Hyperedges& ids, const std::string&
     return result;
 }
 
-std::ostream& operator<< (std::ostream& os , const Mapping& val)
+Hyperedges Hypergraph::neighbourhood(const Hyperedges& ids, const unsigned k, const TraversalDirection dir, const std::string& label,
+                                     const unsigned maxNodes, const unsigned maxFanout) const
 {
-    os << "{ ";
-    for (const auto &pair : val)
+    Hyperedges result;
+    std::unordered_set< UniqueId > visited;
+    Hyperedges frontier;
+
+    // Level 0: the given hedges themselves
+    for (const UniqueId& id : ids)
     {
-        os << "(" << pair.first << " , " << pair.second << ") ";
+        if (result.size() >= maxNodes)
+            return result;
+        if (!exists(id) || visited.count(id))
+            continue;
+        visited.insert(id);
+        result.push_back(id);
+        frontier.push_back(id);
     }
-    os << "} ";
-    return os;
+
+    // Expand one level at a time
+    for (unsigned level = 0; level < k; level++)
+    {
+        Hyperedges next;
+        for (const UniqueId& id : frontier)
+        {
+            const Hyperedge& edge(access(id));
+            // Collect the direct neighbours without creating intermediate unions
+            // NOTE: The caches may contain stale entries, so we have to check them
+            Hyperedges candidates;
+            if ((dir == FORWARD) || (dir == BOTH))
+            {
+                candidates.insert(candidates.end(), edge._to.begin(), edge._to.end());
+                for (const UniqueId& otherId : edge._fromOthers)
+                {
+                    if (access(otherId).isPointingFrom(id))
+                        candidates.push_back(otherId);
+                }
+            }
+            if ((dir == INVERSE) || (dir == BOTH))
+            {
+                candidates.insert(candidates.end(), edge._from.begin(), edge._from.end());
+                for (const UniqueId& otherId : edge._toOthers)
+                {
+                    if (access(otherId).isPointingTo(id))
+                        candidates.push_back(otherId);
+                }
+            }
+
+            // Hubs are part of the neighbourhood but we do not expand them
+            if (candidates.size() > maxFanout)
+                continue;
+
+            for (const UniqueId& otherId : candidates)
+            {
+                if (visited.count(otherId))
+                    continue;
+                if (!label.empty() && (access(otherId).label() != label))
+                    continue;
+                if (result.size() >= maxNodes)
+                    return result;
+                visited.insert(otherId);
+                result.push_back(otherId);
+                next.push_back(otherId);
+            }
+        }
+        if (next.empty())
+            break;
+        frontier.swap(next);
+    }
+    return result;
 }
 
-Mapping fromHyperedges(const Hyperedges& a)
+Hypergraph Hypergraph::subgraph(const Hyperedges& ids) const
 {
-    Mapping result;
-    for (const UniqueId& id : a)
+    Hypergraph result;
+    std::unordered_set< UniqueId > members;
+    // First pass: Clone hedges
+    for (const UniqueId& id : ids)
+    {
+        if (!exists(id))
+            continue;
+        result.create(id, access(id).label(), access(id).properties());
+        members.insert(id);
+    }
+    // Second pass: Wire only among the members (keeping the order of the from and to sets)
+    for (const UniqueId& id : members)
     {
-        result.insert({id, id});
+        for (const UniqueId& toId : access(id).pointingTo())
+        {
+            if (members.count(toId))
+                result.pointsTo(Hyperedges{id}, Hyperedges{toId});
+        }
+        for (const UniqueId& fromId : access(id).pointingFrom())
+        {
+            if (members.count(fromId))
+                result.pointsFrom(Hyperedges{id}, Hyperedges{fromId});
+        }
     }
     return result;
 }
 
-bool equal(const Mapping& a, const Mapping& b)
+HyperedgeLists Hypergraph::weaklyConnectedComponents() const
 {
-    // For two mappings to be equal, they
-    // a) have to have the same size
-    if (a.size() != b.size())
-        return false;
-    // b) for each pair in a:
-    for (const auto& pair : a)
+    const CompactHypergraph compact(*this);
+    return compact.groups(compact.weaklyConnectedComponents());
+}
+
+HyperedgeLists Hypergraph::stronglyConnectedComponents() const
+{
+    const CompactHypergraph compact(*this);
+    return compact.groups(compact.stronglyConnectedComponents());
+}
+
+HyperedgeLists Hypergraph::labelPropagationComponents(const unsigned threads) const
+{
+    const CompactHypergraph compact(*this);
+    return compact.groups(compact.labelPropagationComponents(threads));
+}
+
+std::vector< unsigned > Hypergraph::degreeHistogram(const TraversalDirection dir, const unsigned threads) const
+{
+    return CompactHypergraph(*this).degreeHistogram(dir, threads);
+}
+
+std::map< UniqueId, double > Hypergraph::pageRank(const double damping, const unsigned threads) const
+{
+    const CompactHypergraph compact(*this);
+    const std::vector< double >& rank(compact.pageRank(damping, 100, 1e-9, threads));
+    std::map< UniqueId, double > result;
+    for (Handle h = 0; h < compact.size(); h++)
+        result[compact.id(h)] = rank[h];
+    return result;
+}
+
+std::map< UniqueId, unsigned > Hypergraph::coreNumbers() const
+{
+    const CompactHypergraph compact(*this);
+    const std::vector< unsigned >& cores(compact.coreNumbers());
+    std::map< UniqueId, unsigned > result;
+    for (Handle h = 0; h < compact.size(); h++)
+        result[compact.id(h)] = cores[h];
+    return result;
+}
+
+Hyperedges Hypergraph::uniformSample(const unsigned count, const unsigned seed) const
+{
+    const CompactHypergraph compact(*this);
+    return compact.ids(compact.uniformSample(count, seed));
+}
+
+Hyperedges Hypergraph::randomWalkSample(const Hyperedges& startIds, const unsigned count, const double restart, const TraversalDirection dir, const unsigned seed) const
+{
+    const CompactHypergraph compact(*this);
+    return compact.ids(compact.randomWalkSample(compact.handles(startIds), count, restart, dir, seed));
+}
+
+Hyperedges Hypergraph::forestFireSample(const unsigned count, const double burn, const unsigned seed) const
+{
+    const CompactHypergraph compact(*this);
+    return compact.ids(compact.forestFireSample(count, burn, seed));
+}
+
+MatchState::MatchState(const Hypergraph::MatchEngine engine)
+: _engine(engine),
+  _fromSearchSpace(false)
+{
+    reset();
+}
+
+void MatchState::reset()
+{
+    _prepared = false;
+    _exhausted = false;
+    _queryIds.clear();
+    _candidateIds.clear();
+    _isCandidate.clear();
+    _queryNeighbours.clear();
+    _startId.clear();
+    _order.clear();
+    _constraints.clear();
+    _unmappedNeighbours.clear();
+    _searchSpace = std::stack< Mapping >();
+    _data.reset();
+    _candidates.clear();
+    _search = Search();
+    _symmetries.clear();
+    _automorphisms.clear();
+}
+
+CompiledPattern::Neighbours CompiledPattern::neighboursOf(const Hypergraph& query, const Hyperedges& ids)
+{
+    Neighbours result;
+    for (const UniqueId& id : ids)
     {
-        bool found(false);
-        // there has to be the same pair in b
-        for (const auto& otherPair : b)
+        Hyperedges neighbours(query.allNeighboursOf(Hyperedges{id}));
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        neighbours.erase(std::remove(neighbours.begin(), neighbours.end(), id), neighbours.end());
+        result[id] = neighbours;
+    }
+    return result;
+}
+
+Hyperedges CompiledPattern::orderOf(const Hyperedges& ids, const Neighbours& neighbours, const std::function< unsigned (const UniqueId&) >& cost)
+{
+    Hyperedges order;
+    std::unordered_set< UniqueId > ordered;
+    while (order.size() < ids.size())
+    {
+        UniqueId bestId;
+        unsigned bestConnections = 0;
+        unsigned bestCost = UINT_MAX;
+        unsigned bestDegree = 0;
+        bool found = false;
+        for (const UniqueId& id : ids)
         {
-            if ((pair.first == otherPair.first) && (pair.second == otherPair.second))
+            if (ordered.count(id))
+                continue;
+            const Hyperedges& others(neighbours.at(id));
+            unsigned connections = 0;
+            for (const UniqueId& otherId : others)
             {
-                found = true;
-                break;
+                if (ordered.count(otherId))
+                    connections++;
+            }
+            const unsigned costs(cost(id));
+            const unsigned degree(others.size());
+            if (found)
+            {
+                if (connections < bestConnections)
+                    continue;
+                if ((connections == bestConnections) && (costs > bestCost))
+                    continue;
+                if ((connections == bestConnections) && (costs == bestCost) && (degree <= bestDegree))
+                    continue;
+            }
+            found = true;
+            bestId = id;
+            bestConnections = connections;
+            bestCost = costs;
+            bestDegree = degree;
+        }
+        ordered.insert(bestId);
+        order.push_back(bestId);
+    }
+    return order;
+}
+
+void CompiledPattern::plan(const Hypergraph& query, const Hyperedges& order, const Neighbours& neighbours,
+                           std::vector< Constraints >& constraints, std::vector< unsigned >& unmappedNeighbours)
+{
+    // For each position we collect the constraints to the positions mapped before (or itself)
+    const unsigned n(order.size());
+    std::unordered_map< UniqueId, unsigned > positionOf;
+    for (unsigned i = 0; i < n; i++)
+        positionOf[order[i]] = i;
+    constraints.assign(n, Constraints());
+    unmappedNeighbours.assign(n, 0);
+    auto mappedUntil = [&](const UniqueId& otherId, const unsigned i) -> bool {
+        // NOTE: Hedges outside of the query graph are ignored
+        auto it(positionOf.find(otherId));
+        return (it != positionOf.end()) && (it->second <= i);
+    };
+    for (unsigned i = 0; i < n; i++)
+    {
+        const UniqueId& queryId(order[i]);
+        for (const UniqueId& otherId : query.access(queryId).pointingTo())
+        {
+            if (mappedUntil(otherId, i))
+                constraints[i].push_back({positionOf[otherId], TO});
+        }
+        for (const UniqueId& otherId : query.access(queryId).pointingFrom())
+        {
+            if (mappedUntil(otherId, i))
+                constraints[i].push_back({positionOf[otherId], FROM});
+        }
+        for (unsigned j = 0; j < i; j++)
+        {
+            if (query.access(order[j]).isPointingTo(queryId))
+                constraints[i].push_back({j, IN_TO});
+            if (query.access(order[j]).isPointingFrom(queryId))
+                constraints[i].push_back({j, IN_FROM});
+        }
+        for (const UniqueId& neighbourId : neighbours.at(queryId))
+        {
+            if (positionOf.count(neighbourId) && !mappedUntil(neighbourId, i))
+                unmappedNeighbours[i]++;
+        }
+    }
+}
+
+CompiledPattern::CompiledPattern(const Hypergraph& query)
+: _query(query)
+{
+    Hyperedges ids(query.findByLabel());
+    std::sort(ids.begin(), ids.end());
+    const Neighbours& neighbours(neighboursOf(query, ids));
+    // Without a data graph, we can only guess: Hedges with a label are more selective than the ones without
+    _order = orderOf(ids, neighbours, [&](const UniqueId& id) -> unsigned { return query.access(id).label().empty() ? 1 : 0; });
+    plan(query, _order, neighbours, _constraints, _unmappedNeighbours);
+}
+
+CompiledPattern::CompiledPattern(const Hypergraph& query, const GraphStatistics& statistics)
+: _query(query)
+{
+    Hyperedges ids(query.findByLabel());
+    std::sort(ids.begin(), ids.end());
+    const Neighbours& neighbours(neighboursOf(query, ids));
+    std::unordered_map< UniqueId, double > candidates;
+    std::unordered_map< UniqueId, std::unordered_set< UniqueId > > next;
+    for (const UniqueId& id : ids)
+    {
+        candidates[id] = statistics.candidates(query, id);
+        const Hyperedges& others(query.nextNeighboursOf(Hyperedges{id}));
+        next[id].insert(others.begin(), others.end());
+    }
+
+    std::unordered_set< UniqueId > ordered;
+    while (_order.size() < ids.size())
+    {
+        UniqueId bestId;
+        double bestCost = 0.0;
+        unsigned bestConnections = 0;
+        unsigned bestDegree = 0;
+        bool found = false;
+        for (const UniqueId& id : ids)
+        {
+            if (ordered.count(id))
+                continue;
+            // Expected number of extensions of a partial match by this hedge
+            const std::string& label(query.access(id).label());
+            double cost(candidates[id]);
+            double minFanout = -1.0;
+            double reduction = 1.0;
+            unsigned connections = 0;
+            for (const UniqueId& otherId : neighbours.at(id))
+            {
+                if (!ordered.count(otherId))
+                    continue;
+                connections++;
+                const std::string& otherLabel(query.access(otherId).label());
+                double fanout = -1.0;
+                if (next[otherId].count(id))
+                    fanout = statistics.fanout(otherLabel, label, Hypergraph::FORWARD);
+                if (next[id].count(otherId))
+                {
+                    const double inverse(statistics.fanout(otherLabel, label, Hypergraph::INVERSE));
+                    fanout = (fanout < 0.0) ? inverse : std::min(fanout, inverse);
+                }
+                if (minFanout < 0.0)
+                {
+                    minFanout = fanout;
+                    continue;
+                }
+                // Chance of a candidate to be a neighbour of another mapped hedge as well
+                const unsigned count(statistics.cardinality(label));
+                const double chance(count ? std::min(1.0, std::max(fanout, minFanout) / count) : 0.0);
+                minFanout = std::min(minFanout, fanout);
+                reduction *= chance;
+            }
+            if (connections)
+                cost = std::min(cost, minFanout) * reduction;
+            const unsigned degree(neighbours.at(id).size());
+            if (found)
+            {
+                if (cost > bestCost)
+                    continue;
+                if ((cost == bestCost) && (connections < bestConnections))
+                    continue;
+                if ((cost == bestCost) && (connections == bestConnections) && (degree <= bestDegree))
+                    continue;
             }
+            found = true;
+            bestId = id;
+            bestCost = cost;
+            bestConnections = connections;
+            bestDegree = degree;
         }
-        if (!found)
+        ordered.insert(bestId);
+        _order.push_back(bestId);
+    }
+    plan(query, _order, neighbours, _constraints, _unmappedNeighbours);
+}
+
+CompiledPattern::CompiledPattern(const Hypergraph& query, const Hyperedges& order)
+: _query(query),
+  _order(order)
+{
+    if (!ordersQuery())
+        return;
+    plan(query, _order, neighboursOf(query, _order), _constraints, _unmappedNeighbours);
+}
+
+CompiledPattern::CompiledPattern(const Hypergraph& query, const Hyperedges& order, const std::vector< Constraints >& constraints, const std::vector< unsigned >& unmappedNeighbours)
+: _query(query),
+  _order(order),
+  _constraints(constraints),
+  _unmappedNeighbours(unmappedNeighbours)
+{
+}
+
+bool CompiledPattern::ordersQuery() const
+{
+    Hyperedges ids(_query.findByLabel());
+    Hyperedges sorted(_order);
+    std::sort(ids.begin(), ids.end());
+    std::sort(sorted.begin(), sorted.end());
+    return (ids == sorted);
+}
+
+bool CompiledPattern::valid() const
+{
+    if (!ordersQuery())
+        return false;
+    const unsigned n(_order.size());
+    if ((_constraints.size() != n) || (_unmappedNeighbours.size() != n))
+        return false;
+    // The plan has to fit to the wiring of the query (the constraints of a position may be stored in any order)
+    std::vector< Constraints > constraints;
+    std::vector< unsigned > unmappedNeighbours;
+    plan(_query, _order, neighboursOf(_query, _order), constraints, unmappedNeighbours);
+    if (unmappedNeighbours != _unmappedNeighbours)
+        return false;
+    for (unsigned i = 0; i < n; i++)
+    {
+        Constraints stored(_constraints[i]);
+        std::sort(stored.begin(), stored.end());
+        std::sort(constraints[i].begin(), constraints[i].end());
+        if (stored != constraints[i])
             return false;
     }
     return true;
 }
 
-Mapping invert(const Mapping& m)
+void Hypergraph::prepareMatch(const Hypergraph& other, MatchState& state) const
+{
+    state._prepared = true;
+    const Hyperedges& otherIds(state._queryIds);
+
+    // No candidates, no match
+    for (const UniqueId& otherId : otherIds)
+    {
+        if (state._candidateIds[otherId].empty())
+        {
+            state._exhausted = true;
+            return;
+        }
+    }
+
+    // Query adjacency: The distinct neighbours of each query hedge (without itself)
+    state._queryNeighbours = CompiledPattern::neighboursOf(other, otherIds);
+
+    if (state._engine == ULLMANN)
+    {
+        // Find a good starting hedge: maxDegree - minCandidates should be maximal
+        unsigned int minCandidates = UINT_MAX;
+        unsigned int maxDegree = 0;
+        int bestValue = INT_MIN;
+        for (const UniqueId& otherId : otherIds)
+        {
+            // Check candidate size
+            if (state._candidateIds[otherId].size() < minCandidates)
+                minCandidates = state._candidateIds[otherId].size();
+            // Check degree
+            unsigned int degree(other.access(otherId).indegree() + other.access(otherId).outdegree());
+            if (degree > maxDegree)
+                maxDegree = degree;
+            int value = maxDegree - minCandidates;
+            if (value < bestValue)
+                continue;
+            bestValue = value;
+            state._startId = otherId;
+        }
+        return;
+    }
+
+    for (const UniqueId& otherId : otherIds)
+    {
+        const Hyperedges& candidates(state._candidateIds[otherId]);
+        state._isCandidate[otherId].insert(candidates.begin(), candidates.end());
+    }
+
+    // Compute the match order: The hedges with the fewest candidates are the most selective ones
+    state._order = CompiledPattern::orderOf(otherIds, state._queryNeighbours, [&](const UniqueId& id) -> unsigned { return state._candidateIds[id].size(); });
+    CompiledPattern::plan(other, state._order, state._queryNeighbours, state._constraints, state._unmappedNeighbours);
+    if (state._fromSearchSpace)
+        return;
+
+    // The in place search works on the handles of a snapshot
+    state.bind(*this);
+}
+
+void Hypergraph::prepareMatch(const CompiledPattern& pattern, MatchState& state) const
+{
+    state._engine = VF2;
+    state._fromSearchSpace = false;
+    state._prepared = true;
+    if (!pattern.valid())
+    {
+        state._exhausted = true;
+        return;
+    }
+    for (const UniqueId& otherId : state._queryIds)
+    {
+        if (state._candidateIds[otherId].empty())
+        {
+            state._exhausted = true;
+            return;
+        }
+    }
+    state._order = pattern._order;
+    state._constraints = pattern._constraints;
+    state._unmappedNeighbours = pattern._unmappedNeighbours;
+    state.bind(*this);
+}
+
+void MatchState::bind(const Hypergraph& data)
+{
+    const unsigned n(_order.size());
+    _data = std::make_shared< CompactHypergraph >(data);
+    _candidates.resize(n);
+    for (unsigned i = 0; i < n; i++)
+    {
+        std::vector< Handle >& candidates(_candidates[i]);
+        candidates = _data->handles(_candidateIds[_order[i]]);
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+        if (candidates.empty())
+        {
+            _exhausted = true;
+            return;
+        }
+    }
+}
+
+Mapping Hypergraph::nextMatch(const Hypergraph& other, MatchState& state) const
 {
+    if (state._exhausted)
+        return Mapping();
     Mapping result;
-    for (const auto &pair : m)
+    if (state._engine == ULLMANN)
     {
-        result.insert({pair.second, pair.first});
+        result = matchUllmann(other, state);
+    } else if (state._fromSearchSpace) {
+        result = matchVF2(other, state);
+    } else {
+        result = matchVF2InPlace(state);
     }
+    if (result.empty())
+        state._exhausted = true;
     return result;
 }
 
-Mapping join(const Mapping& a, const Mapping& b)
+/*
+	Possible improvements:
+        * Instead of searching for possible candidates beforhand, we search only for the candidates for ONE query hedge (BB-Graph algorithm)
+        * Selecting the next query hedge and its candidates should respect locality of the already mapped hedges
+*/
+Mapping Hypergraph::matchUllmann(const Hypergraph& other, MatchState& state) const
 {
-    Mapping result;
-    for (const auto& pair : a)
+    // This algorithm is according to Ullmann
+    // and has been implemented following "An In-depth Comparison of Subgraph Isomorphism Algorithms in Graph Databases"
+    // First step: For each vertex in subgraph, we find other suitable candidates (done by match & prepareMatch)
+    const Hyperedges& otherIds(state._queryIds);
+    std::unordered_map< UniqueId, Hyperedges >& candidateIds(state._candidateIds);
+    std::stack< Mapping >& searchSpace(state._searchSpace);
+
+    // Second step: Prepopulate the searchSpace with all mappings from startUid -> candidateId in candidateIds
+    // ONLY IF SEARCH SPACE IS EMPTY
+    // NOTE: The empty mapping at the bottom marks the end of the search. Otherwise we could not distinguish a new search from an exhausted one.
+    if (searchSpace.empty())
+    {
+        searchSpace.push(Mapping());
+        for (const UniqueId& candidateId : candidateIds[state._startId])
+        {
+            Mapping initial;
+            initial.insert({state._startId,candidateId});
+            searchSpace.push(initial);
+        }
+    }
+
+    unsigned int minCandidates;
+    unsigned int maxDegree;
+    int bestValue;
+    while (!searchSpace.empty())
+    {
+        // Get top of stack
+        const Mapping currentMapping(searchSpace.top());
+        searchSpace.pop();
+
+        // Check if we can stop the search
+        if (currentMapping.size() == otherIds.size())
+        {
+            return currentMapping;
+        }
+        if (currentMapping.empty())
+            break;
+
+	// Custom selection:
+	// * should be a neighbour of already matched query nodes
+	// * should have the minimum amount of candidates
+	// * should have the maximum degree
+        minCandidates = UINT_MAX;
+        maxDegree = 0;
+        unsigned int maxOverlap = 0;
+        bestValue = INT_MIN;
+	UniqueId unmappedId;
+	for (const UniqueId& otherId : otherIds)
+	{
+            // If mapped, skip
+            if (currentMapping.find(otherId) != currentMapping.end())
+                continue;
+
+	    // Check candidate size
+	    if (candidateIds[otherId].size() < minCandidates)
+                minCandidates = candidateIds[otherId].size();
+
+            // Check degree
+            unsigned int degree(other.access(otherId).indegree() + other.access(otherId).outdegree());
+            if (degree > maxDegree)
+                maxDegree = degree;
+
+            // Check neighbourhood to already mapped hedges
+	    const Hyperedges& neighbourhood(state._queryNeighbours[otherId]);
+            unsigned overlap = 0;
+            for (const UniqueId& neighbourId : neighbourhood)
+            {
+                if (currentMapping.find(neighbourId) != currentMapping.end())
+                    overlap++;
+            }
+	    if (overlap > maxOverlap)
+                maxOverlap = overlap;
+
+            int value = maxDegree + maxOverlap - minCandidates;
+            if (value < bestValue)
+                continue;
+            // If we are here, we found a good unmapped hedge
+            bestValue = value;
+	    unmappedId = otherId;
+	}
+
+        // Found unmapped hedge
+        // NOTE: This is actually what makes this method an Ullmann algorithm
+        const Mapping& currentMappingInv(invert(currentMapping));
+        const Hyperedges& candidates(candidateIds[unmappedId]);
+        const Hyperedges& unmappedNextNeighbours(other.isPointingTo(Hyperedges{unmappedId}));
+        const Hyperedges& unmappedPrevNeighbours(other.isPointingFrom(Hyperedges{unmappedId}));
+        for (const UniqueId& candidateId : candidates)
+        {
+            // If we want a bijective matching, we have to make sure that candidates are not mapped multiple times!!!
+            if (currentMappingInv.find(candidateId) != currentMappingInv.end())
+                continue;
+
+            // We have now the neighbourhood of the unmapped hedge and the neighbourhood of the candidate
+            const Hyperedges& candidateNextNeighbours(isPointingTo(Hyperedges{candidateId}));
+            const Hyperedges& candidatePrevNeighbours(isPointingFrom(Hyperedges{candidateId}));
+            // If the candidate neighbourhood is less than the unmapped neighbourhood, a future match is IMPOSSIBLE
+            if (candidateNextNeighbours.size() < unmappedNextNeighbours.size())
+                continue;
+            if (candidatePrevNeighbours.size() < unmappedPrevNeighbours.size())
+                continue;
+
+            // NOTE: Degree has already been checked in initial candidate filtering
+            // Construct the new match
+            Mapping newMapping(currentMapping);
+            newMapping.insert({unmappedId, candidateId});
+
+            // Check for validity (QUICKSI style)
+            // For a correct mapping we have to check if all from and to sets are correct (similar to the check in rewrite)
+            bool valid = true;
+            for (const auto& pair : newMapping)
+            {
+                const Hyperedges& templatePointsTo(other.isPointingTo(Hyperedges{pair.first}));
+                const Hyperedges& templatePointsFrom(other.isPointingFrom(Hyperedges{pair.first}));
+                const Hyperedges& matchPointsTo(isPointingTo(Hyperedges{pair.second}));
+                const Hyperedges& matchPointsFrom(isPointingFrom(Hyperedges{pair.second}));
+                for (const UniqueId& templateId : templatePointsTo)
+                {
+                    Mapping::const_iterator it(newMapping.find(templateId));
+                    if (it == newMapping.end())
+                        continue;
+                    const UniqueId& matchId(it->second);
+                    if (std::find(matchPointsTo.begin(), matchPointsTo.end(), matchId) == matchPointsTo.end())
+                    {
+                        valid = false;
+                        break;
+                    }
+                }
+                if (!valid)
+                    break;
+                for (const UniqueId& templateId : templatePointsFrom)
+                {
+                    Mapping::const_iterator it(newMapping.find(templateId));
+                    if (it == newMapping.end())
+                        continue;
+                    const UniqueId& matchId(it->second);
+                    if (std::find(matchPointsFrom.begin(), matchPointsFrom.end(), matchId) == matchPointsFrom.end())
+                    {
+                        valid = false;
+                        break;
+                    }
+                }
+                if (!valid)
+                    break;
+            }
+            if (!valid)
+                continue;
+
+            // Insert valid mapping
+            searchSpace.push(newMapping);
+        }
+    }
+    return Mapping();
+}
+
+/*
+    VF2 style matching (see "VF2++ - An improved subgraph isomorphism algorithm" and "Challenging the time complexity of exact subgraph isomorphism for huge and dense graphs with VF3")
+    In contrast to the algorithm above
+    * the order in which the query hedges get mapped is computed once (most constrained first, then growing along the neighbourhood)
+    * candidates are taken from the neighbourhood of an already mapped hedge whenever possible
+    * only the pairs involving the new hedge are checked (all other pairs have been checked before)
+    * a candidate needs at least as many unused neighbours as the query hedge has unmapped neighbours (look-ahead on the terminal sets)
+    The states in the searchSpace are partial mappings of the first hedges in the match order, so a search can be resumed like above.
+*/
+Mapping Hypergraph::matchVF2(const Hypergraph& other, MatchState& state) const
+{
+    // The candidates, the match order and the constraints have been computed by prepareMatch
+    const unsigned n(state._queryIds.size());
+    const Hyperedges& order(state._order);
+    std::unordered_map< UniqueId, Hyperedges >& candidateIds(state._candidateIds);
+    std::unordered_map< UniqueId, std::unordered_set< UniqueId > >& isCandidate(state._isCandidate);
+    const std::vector< CompiledPattern::Constraints >& constraints(state._constraints);
+    const std::vector< unsigned >& unmappedNeighbours(state._unmappedNeighbours);
+    std::stack< Mapping >& searchSpace(state._searchSpace);
+
+    // Depth first search over the partial mappings
+    // ONLY IF SEARCH SPACE IS EMPTY we start from scratch. As above, the empty mapping at the bottom marks the end of the search.
+    if (searchSpace.empty())
+    {
+        searchSpace.push(Mapping());
+        searchSpace.push(Mapping());
+    }
+
+    while (!searchSpace.empty())
     {
-        // In case of a multimap, we have to find all occurences of a.first in b
-        for (const auto& otherPair : b)
+        const Mapping currentMapping(searchSpace.top());
+        searchSpace.pop();
+
+        // Check if we can stop the search
+        if (currentMapping.size() == n)
+            return currentMapping;
+        if (currentMapping.empty() && searchSpace.empty())
+            break;
+
+        const unsigned position(currentMapping.size());
+        const UniqueId& queryId(order[position]);
+        std::unordered_set< UniqueId > used;
+        for (const auto& pair : currentMapping)
+            used.insert(pair.second);
+        auto mapped = [&](const UniqueId& otherId) -> const UniqueId& { return currentMapping.find(otherId)->second; };
+
+        // Take the candidates from the smallest neighbourhood of an already mapped hedge (if there is one)
+        const Hyperedges* candidates(&candidateIds[queryId]);
+        Hyperedges local;
+        bool isLocal = false;
+        for (const auto& constraint : constraints[position])
         {
-            if (pair.first != otherPair.first)
+            if (constraint.first == position)
                 continue;
-            result.insert({pair.second, otherPair.second});
+            const Hyperedge& image(access(mapped(order[constraint.first])));
+            Hyperedges neighbours;
+            switch (constraint.second)
+            {
+                case CompiledPattern::TO:
+                    neighbours = image._toOthers;
+                    break;
+                case CompiledPattern::FROM:
+                    neighbours = image._fromOthers;
+                    break;
+                case CompiledPattern::IN_TO:
+                    neighbours = image.pointingTo();
+                    break;
+                case CompiledPattern::IN_FROM:
+                    neighbours = image.pointingFrom();
+                    break;
+            }
+            if (!isLocal || (neighbours.size() < local.size()))
+            {
+                local.swap(neighbours);
+                isLocal = true;
+            }
+        }
+        if (isLocal)
+        {
+            std::sort(local.begin(), local.end());
+            local.erase(std::unique(local.begin(), local.end()), local.end());
+            candidates = &local;
         }
+
+        // Extend the mapping by all feasible candidates. Pushing them in reverse order lets us visit them in order.
+        for (auto it = candidates->rbegin(); it != candidates->rend(); it++)
+        {
+            const UniqueId& candidateId(*it);
+            if (used.count(candidateId))
+                continue;
+            if (isLocal && !isCandidate[queryId].count(candidateId))
+                continue;
+
+            // Check the pairs involving the new hedge
+            // NOTE: The caches of other hedges may be outdated, so this also validates the candidates taken from them
+            const Hyperedge& candidate(access(candidateId));
+            bool valid = true;
+            for (const auto& constraint : constraints[position])
+            {
+                const UniqueId& imageId((constraint.first == position) ? candidateId : mapped(order[constraint.first]));
+                switch (constraint.second)
+                {
+                    case CompiledPattern::TO:
+                        valid = candidate.isPointingTo(imageId);
+                        break;
+                    case CompiledPattern::FROM:
+                        valid = candidate.isPointingFrom(imageId);
+                        break;
+                    case CompiledPattern::IN_TO:
+                        valid = access(imageId).isPointingTo(candidateId);
+                        break;
+                    case CompiledPattern::IN_FROM:
+                        valid = access(imageId).isPointingFrom(candidateId);
+                        break;
+                }
+                if (!valid)
+                    break;
+            }
+            if (!valid)
+                continue;
+
+            // Look-ahead: Every unmapped neighbour of the query hedge needs its own unused neighbour of the candidate
+            if (unmappedNeighbours[position])
+            {
+                unsigned unusedNeighbours = 0;
+                for (const UniqueId& neighbourId : allNeighboursOf(Hyperedges{candidateId}))
+                {
+                    if ((neighbourId != candidateId) && !used.count(neighbourId))
+                        unusedNeighbours++;
+                }
+                if (unusedNeighbours < unmappedNeighbours[position])
+                    continue;
+            }
+
+            Mapping newMapping(currentMapping);
+            newMapping.insert({queryId, candidateId});
+            searchSpace.push(newMapping);
+        }
+    }
+    return Mapping();
+}
+
+static bool contains(const HandleRange& range, const Handle h)
+{
+    return std::find(range.begin(), range.end(), h) != range.end();
+}
+
+/*
+    The same search as above, but without copying mappings (see MatchState)
+    The constraints are checked on the handles of the snapshot and the candidates of a position are taken from the neighbourhood
+    (next/previous, both sorted & duplicate free) of a mapped hedge or from the sorted candidate list.
+*/
+void MatchState::start(Search& search) const
+{
+    const unsigned n(_order.size());
+    if ((search.mapped.size() != n) || (search.used.size() != _data->size()))
+    {
+        search.mapped.assign(n, CompactHypergraph::Invalid);
+        search.cursor.assign(n, nullptr);
+        search.end.assign(n, nullptr);
+        search.local.assign(n, false);
+        search.used.assign(_data->size(), false);
+    } else {
+        // Reuse the arrays of a previous search: Only the hedges used by its mapped positions have to be released
+        for (unsigned i = 0; i < search.depth; i++)
+            search.used[search.mapped[i]] = false;
+    }
+    search.depth = 0;
+    open(search, 0);
+}
+
+bool MatchState::start(Search& search, const unsigned root) const
+{
+    start(search);
+    if (!feasible(search, 0, root))
+        return false;
+    search.mapped[0] = root;
+    search.used[root] = true;
+    search.depth = 1;
+    if (search.depth < _order.size())
+        open(search, search.depth);
+    return true;
+}
+
+void MatchState::open(Search& search, const unsigned position) const
+{
+    // Select the smallest candidate range
+    bool local = false;
+    HandleRange range{nullptr, nullptr};
+    for (const auto& constraint : _constraints[position])
+    {
+        if (constraint.first == position)
+            continue;
+        const Handle image(search.mapped[constraint.first]);
+        const HandleRange& neighbours(((constraint.second == CompiledPattern::TO) || (constraint.second == CompiledPattern::IN_FROM)) ? _data->previous(image) : _data->next(image));
+        if (!local || (neighbours.size() < range.size()))
+        {
+            range = neighbours;
+            local = true;
+        }
+    }
+    if (!local)
+    {
+        const std::vector< Handle >& candidates(_candidates[position]);
+        range = HandleRange{candidates.data(), candidates.data() + candidates.size()};
+    }
+    search.cursor[position] = range.first;
+    search.end[position] = range.last;
+    search.local[position] = local;
+}
+
+bool MatchState::feasible(const Search& search, const unsigned position, const Handle candidate) const
+{
+    if (search.used[candidate])
+        return false;
+    if (search.local[position])
+    {
+        const std::vector< Handle >& candidates(_candidates[position]);
+        if (!std::binary_search(candidates.begin(), candidates.end(), candidate))
+            return false;
+    }
+    for (const auto& constraint : _constraints[position])
+    {
+        const Handle image((constraint.first == position) ? candidate : search.mapped[constraint.first]);
+        bool valid = false;
+        switch (constraint.second)
+        {
+            case CompiledPattern::TO:
+                valid = contains(_data->pointingTo(candidate), image);
+                break;
+            case CompiledPattern::FROM:
+                valid = contains(_data->pointingFrom(candidate), image);
+                break;
+            case CompiledPattern::IN_TO:
+                valid = contains(_data->pointingTo(image), candidate);
+                break;
+            case CompiledPattern::IN_FROM:
+                valid = contains(_data->pointingFrom(image), candidate);
+                break;
+        }
+        if (!valid)
+            return false;
+    }
+    // Symmetry breaking: Only one match per orbit
+    if (!_symmetries.empty())
+    {
+        for (const unsigned other : _symmetries[position])
+        {
+            if (candidate <= search.mapped[other])
+                return false;
+        }
+    }
+    // Look-ahead: Every unmapped neighbour of the query hedge needs its own unused neighbour of the candidate
+    const unsigned needed(_unmappedNeighbours[position]);
+    unsigned unused = 0;
+    for (const Handle neighbour : _data->neighbours(candidate))
+    {
+        if (unused >= needed)
+            break;
+        if ((neighbour != candidate) && !search.used[neighbour])
+            unused++;
+    }
+    return unused >= needed;
+}
+
+bool MatchState::next(Search& search, const unsigned fixed, const std::atomic< bool >* cancelled) const
+{
+    const unsigned n(_order.size());
+    if (search.depth == n)
+    {
+        // Resume after the last match: Undo the last position (unless it is fixed)
+        if (search.depth == fixed)
+            return false;
+        search.depth--;
+        search.used[search.mapped[search.depth]] = false;
+    }
+
+    while (!cancelled || !cancelled->load(std::memory_order_relaxed))
+    {
+        const unsigned position(search.depth);
+        // Find the next feasible candidate of the current position
+        Handle candidate(CompactHypergraph::Invalid);
+        while (search.cursor[position] != search.end[position])
+        {
+            const Handle other(*search.cursor[position]++);
+            if (feasible(search, position, other))
+            {
+                candidate = other;
+                break;
+            }
+        }
+
+        if (candidate == CompactHypergraph::Invalid)
+        {
+            // Backtrack
+            if (search.depth <= fixed)
+                return false;
+            search.depth--;
+            search.used[search.mapped[search.depth]] = false;
+            continue;
+        }
+
+        // Extend
+        search.mapped[position] = candidate;
+        search.used[candidate] = true;
+        search.depth++;
+        if (search.depth == n)
+            return true;
+        open(search, search.depth);
+    }
+    return false;
+}
+
+Mapping MatchState::mapping(const Search& search, const unsigned automorphism) const
+{
+    // The variant of automorphism a maps the hedge at position i to the image of position a[i]
+    Mapping result;
+    for (unsigned i = 0; i < _order.size(); i++)
+        result.insert({_order[i], _data->id(search.mapped[_automorphisms.empty() ? i : _automorphisms[automorphism][i]])});
+    return result;
+}
+
+Mapping Hypergraph::matchVF2InPlace(MatchState& state) const
+{
+    if (state._search.mapped.empty())
+        state.start(state._search);
+    if (state.next(state._search, 0))
+        return state.mapping(state._search);
+    return Mapping();
+}
+
+/*
+    Symmetry breaking (Grochow & Kellis)
+    If an automorphism of the query maps every hedge to one with the same candidates, it turns every match into another one.
+    To find only one match per orbit, we go through the positions in match order: The orbit of a position under all automorphisms
+    fixing the earlier positions is found by searching the query graph in itself. If the orbit is not trivial, the image of the position has to be
+    smaller than the images of the other members of its orbit. Then the position gets fixed as well.
+*/
+void Hypergraph::breakSymmetries(const Hypergraph& other, MatchState& state, const bool expand) const
+{
+    if (state._exhausted)
+        return;
+    const unsigned n(state._order.size());
+    std::unordered_map< UniqueId, unsigned > positionOf;
+    for (unsigned i = 0; i < n; i++)
+        positionOf[state._order[i]] = i;
+    // Only hedges with the same candidates can be swapped
+    std::vector< unsigned > classOf(n);
+    std::map< std::vector< Handle >, unsigned > classes;
+    for (unsigned i = 0; i < n; i++)
+        classOf[i] = classes.insert({state._candidates[i], classes.size()}).first->second;
+
+    // Searches the automorphisms which map the hedge at position i to one of the hedges at the allowed positions
+    auto automorphisms = [&](const std::vector< std::vector< unsigned > >& allowed, const std::function< bool (const Mapping&) >& f) -> void {
+        MatchState self(VF2);
+        self._queryIds = state._queryIds;
+        for (unsigned i = 0; i < n; i++)
+        {
+            for (const unsigned j : allowed[i])
+                self._candidateIds[state._order[i]].push_back(state._order[j]);
+        }
+        other.prepareMatch(other, self);
+        Mapping m;
+        while ((m = other.nextMatch(other, self)).size())
+        {
+            if (!f(m))
+                break;
+        }
+    };
+    std::vector< bool > fixed(n, false);
+    auto allowed = [&]() -> std::vector< std::vector< unsigned > > {
+        std::vector< std::vector< unsigned > > result(n);
+        for (unsigned i = 0; i < n; i++)
+        {
+            for (unsigned j = 0; j < n; j++)
+            {
+                if ((fixed[i] && (i == j)) || (!fixed[i] && !fixed[j] && (classOf[i] == classOf[j])))
+                    result[i].push_back(j);
+            }
+        }
+        return result;
+    };
+
+    if (expand)
+    {
+        // All automorphisms as permutations of the positions
+        automorphisms(allowed(), [&](const Mapping& m) -> bool {
+            std::vector< unsigned > permutation(n);
+            for (unsigned i = 0; i < n; i++)
+                permutation[i] = positionOf[m.find(state._order[i])->second];
+            state._automorphisms.push_back(permutation);
+            return true;
+        });
+    }
+
+    state._symmetries.assign(n, std::vector< unsigned >());
+    for (unsigned i = 0; i < n; i++)
+    {
+        // NOTE: Since the orbits are disjoint and all earlier positions are fixed, only later positions can be part of the orbit
+        for (unsigned j = i + 1; j < n; j++)
+        {
+            if (classOf[i] != classOf[j])
+                continue;
+            std::vector< std::vector< unsigned > > swapped(allowed());
+            swapped[i] = std::vector< unsigned >{j};
+            bool found = false;
+            automorphisms(swapped, [&](const Mapping& m) -> bool {
+                found = true;
+                return false;
+            });
+            if (found)
+                state._symmetries[j].push_back(i);
+        }
+        fixed[i] = true;
+    }
+}
+
+MatchSummary Hypergraph::enumerateMatches(const MatchState& state, const std::function< bool (const Mapping&) >& sink, const MatchOptions& options) const
+{
+    MatchSummary summary;
+    summary.matches = 0;
+    summary.complete = true;
+    if (state._exhausted)
+        return summary;
+
+    // Every candidate of the first position is one task
+    const std::vector< Handle >& roots(state._candidates[0]);
+    const unsigned long long maxResults(options.maxResults ? options.maxResults : ULLONG_MAX);
+    const bool deterministic(options.deterministic && !options.countOnly);
+    std::mutex sinkMutex;
+    std::atomic< bool > cancelled(false);
+    std::atomic< unsigned long long > counted(0);
+    unsigned long long passed = 0;
+    // Deterministic mode: The matches of each task are buffered and passed on in task order
+    std::vector< std::vector< Mapping > > buffers(deterministic ? roots.size() : 0);
+    std::vector< bool > finished(deterministic ? roots.size() : 0, false);
+    unsigned nextTask = 0;
+    auto pass = [&](const Mapping& mapping) -> void {
+        // NOTE: Called with sinkMutex locked
+        if (cancelled)
+            return;
+        passed++;
+        if (!sink(mapping) || (passed >= maxResults))
+            cancelled = true;
+    };
+    auto count = [&](const unsigned long long matches) -> void {
+        unsigned long long current(counted.load());
+        while (current < maxResults)
+        {
+            const unsigned long long next(std::min(maxResults, current + matches));
+            if (counted.compare_exchange_weak(current, next))
+            {
+                current = next;
+                break;
+            }
+        }
+        if (current >= maxResults)
+            cancelled = true;
+    };
+    // With expanded symmetries, every match stands for all of its automorphic variants
+    const unsigned variants(state._automorphisms.empty() ? 1 : state._automorphisms.size());
+
+    // Wall clock budget: A watchdog cancels the search when the budget is used up
+    std::mutex watchdogMutex;
+    std::condition_variable searchDone;
+    bool isDone = false;
+    std::thread watchdog;
+    if (options.timeBudget)
+    {
+        watchdog = std::thread([&]() {
+            std::unique_lock< std::mutex > lock(watchdogMutex);
+            if (!searchDone.wait_for(lock, std::chrono::milliseconds(options.timeBudget), [&]() -> bool { return isDone; }))
+                cancelled = true;
+        });
+    }
+
+    std::vector< MatchState::Search > searches(threadCount(options.threads));
+    parallelForEachTask(0, roots.size(), options.threads, [&](const unsigned task, const unsigned t) -> bool {
+        MatchState::Search& search(searches[t]);
+        if (state.start(search, roots[task]))
+        {
+            // NOTE: A query with a single hedge is matched by the root itself
+            bool found((search.depth == state._order.size()) || state.next(search, 1, &cancelled));
+            while (found)
+            {
+                if (options.countOnly)
+                {
+                    count(variants);
+                    found = state.next(search, 1, &cancelled);
+                    continue;
+                }
+                {
+                    std::lock_guard< std::mutex > lock(sinkMutex);
+                    if (deterministic && (task != nextTask))
+                    {
+                        for (unsigned v = 0; v < variants; v++)
+                            buffers[task].push_back(state.mapping(search, v));
+                    } else {
+                        // NOTE: In deterministic mode, the task next in order can pass its matches on directly
+                        if (deterministic)
+                        {
+                            for (const Mapping& mapping : buffers[task])
+                                pass(mapping);
+                            std::vector< Mapping >().swap(buffers[task]);
+                        }
+                        for (unsigned v = 0; v < variants; v++)
+                            pass(state.mapping(search, v));
+                    }
+                }
+                found = state.next(search, 1, &cancelled);
+            }
+        }
+        if (deterministic)
+        {
+            // Pass on the buffers of all finished tasks which are next in order
+            std::lock_guard< std::mutex > lock(sinkMutex);
+            finished[task] = true;
+            while ((nextTask < roots.size()) && finished[nextTask])
+            {
+                for (const Mapping& mapping : buffers[nextTask])
+                    pass(mapping);
+                std::vector< Mapping >().swap(buffers[nextTask]);
+                nextTask++;
+            }
+        }
+        return !cancelled;
+    });
+
+    if (watchdog.joinable())
+    {
+        {
+            std::lock_guard< std::mutex > lock(watchdogMutex);
+            isDone = true;
+        }
+        searchDone.notify_one();
+        watchdog.join();
+    }
+    summary.matches = options.countOnly ? counted.load() : passed;
+    summary.complete = !cancelled;
+    return summary;
+}
+
+/*
+* This algorithm is a single pushout (SPO) graph transformation algorithm
+*/
+Hypergraph Hypergraph::rewrite(const Mapping& m, const Hypergraph& rhs, const Mapping& partialMap) const
+{
+    Hypergraph result;
+    Mapping original2new;
+    Mapping replacement2new;
+
+    // First step: We need a match of lhs in this graph
+    // No match? Return empty graph
+    if (!m.size())
+        return result;
+
+    // Second step: recreate all HYPEREDGES which are NOT PART of the match! (G\lhs)
+    const Hyperedges& originals(findByLabel());
+    const Mapping& mInv(invert(m));
+    std::vector< Mapping::value_type > unmatched;
+    unmatched.reserve(originals.size());
+    for (const UniqueId& originalId : originals)
+    {
+        if (mInv.count(originalId))
+            continue;
+        // Does not exist for sure, so will always succeed
+        result.create(originalId, access(originalId).label());
+        unmatched.push_back({originalId, originalId});
+    }
+    // NOTE: Build the translation at once instead of inserting every pair into the middle
+    original2new = Mapping(unmatched.begin(), unmatched.end());
+
+    // Third step: Cycle over matches
+    // Here, we either delete OR preserve & alter originals
+    // NOTE: Deletion here is IMPLICIT (by not creating it)
+    // m : matchedId -> originalId, partialMap : matchedId -> replacementId
+    const Mapping& original2replacement(join(m, partialMap));
+    for (const auto& pair : original2replacement)
+    {
+        const UniqueId& originalId(pair.first);
+        const UniqueId& replacementId(pair.second);
+
+        // Handle label
+        std::string label(rhs.access(replacementId).label());
+        if (label.empty())
+        {
+            label = access(originalId).label();
+        }
+
+        // Handle uid
+        // We want to keep the original UID unless ...
+        UniqueId uid(originalId);
+
+        // ... multiple originals shall be replaced by one. Then we have to map to the SAME UID (merge)
+        Mapping::const_iterator it(replacement2new.find(replacementId));
+        if (it != replacement2new.end())
+        {
+            // If an original already has been altered by the same replacement UID, we reuse the UID of that original
+            uid = it->second;
+        }
+
+        // ... one original shall be replaced by multiple replacements
+        it = original2new.find(originalId);
+        if (it != original2new.end())
+        {
+            // If a completely new hedge has to be created we have to generate a UID by ourselves ... The best we could do is concatenating the known UIDs?!
+            uid = originalId + replacementId;
+        }
+
+        // Here, we know everything we need to perform the replacement
+        result.create(uid, label);
+        original2new.insert({originalId, uid});
+        replacement2new.insert({replacementId, uid});
+    }
+
+    // Fourth step: Now all hedges in rhs which are not in result yet, have to be created
+    const Hyperedges& replacements(rhs.findByLabel());
+    const Mapping& rInv(invert(partialMap));
+    for (const UniqueId& replacementId : replacements)
+    {
+        if (rInv.count(replacementId))
+            continue;
+        // Create the new hedge. If uid is already taken, it will map to the same element
+        result.create(replacementId, rhs.access(replacementId).label());
+        replacement2new.insert({replacementId, replacementId});
+    }
+
+
+    // Fifth step: Wiring
+    // A) Reconstruct wiring of original hedges
+    Mapping::const_iterator srcPair;
+    for (srcPair = original2new.begin(); srcPair != original2new.end(); srcPair++)
+    {
+        const UniqueId& firstIdOld(srcPair->first);
+        const UniqueId& firstId(srcPair->second);
+
+        // Remember that we only have to handle the pairs (first, *) once, so the next loop can start at srcPair!
+        Mapping::const_iterator destPair;
+        for (destPair = srcPair; destPair != original2new.end(); destPair++)
+        {
+            const UniqueId& secondIdOld(destPair->first);
+            const UniqueId& secondId(destPair->second);
+
+	    // If both hedges are part of the MATCH we should not reconstruct the wiring
+            if (mInv.count(firstIdOld) && mInv.count(secondIdOld))
+		continue;
+
+            // Reconstruct wiring
+            if (access(firstIdOld).isPointingTo(secondIdOld))
+                result.access(firstId).pointsTo(secondId);
+            if (access(secondIdOld).isPointingTo(firstIdOld))
+                result.access(secondId).pointsTo(firstId);
+            if (access(firstIdOld).isPointingFrom(secondIdOld))
+                result.access(firstId).pointsFrom(secondId);
+            if (access(secondIdOld).isPointingFrom(firstIdOld))
+                result.access(secondId).pointsFrom(firstId);
+        }
+    }
+
+    // B) Reconstruct wiring of the replacement graph
+    for (srcPair = replacement2new.begin(); srcPair != replacement2new.end(); srcPair++)
+    {
+        const UniqueId& firstIdOld(srcPair->first);
+        const UniqueId& firstId(srcPair->second);
+
+        // Remember that we only have to handle the pairs (first, *) once, so the next loop can start at srcPair!
+        Mapping::const_iterator destPair;
+        for (destPair = srcPair; destPair != replacement2new.end(); destPair++)
+        {
+            const UniqueId& secondIdOld(destPair->first);
+            const UniqueId& secondId(destPair->second);
+
+            // Reconstruct wiring
+            if (rhs.access(firstIdOld).isPointingTo(secondIdOld))
+                result.access(firstId).pointsTo(secondId);
+            if (rhs.access(secondIdOld).isPointingTo(firstIdOld))
+                result.access(secondId).pointsTo(firstId);
+            if (rhs.access(firstIdOld).isPointingFrom(secondIdOld))
+                result.access(firstId).pointsFrom(secondId);
+            if (rhs.access(secondIdOld).isPointingFrom(firstIdOld))
+                result.access(secondId).pointsFrom(firstId);
+        }
+    }
+
+    return result;
+}
+
+/*
+    The same single pushout as above, but applied to this graph:
+    Only the matched hedges get altered, merged, split or deleted and only their wiring to the rest of the graph (the boundary) gets translated.
+    NOTE: Like above, wires are reconstructed once per pair of hedges (multiple wires between a matched hedge and its neighbour collapse).
+*/
+Hyperedges Hypergraph::rewriteInPlace(const Mapping& m, const Hypergraph& rhs, const Mapping& partialMap)
+{
+    if (!m.size())
+        return Hyperedges();
+
+    // The matched hedges (Zero is never rewritten)
+    std::unordered_set< UniqueId > matched;
+    for (const auto& pair : m)
+    {
+        if ((pair.second != Zero) && exists(pair.second))
+            matched.insert(pair.second);
+    }
+
+    // First step: Remember the boundary of every matched hedge
+    struct Boundary
+    {
+        Hyperedges to, from;            // the hedges it points to (from)
+        Hyperedges toUs, fromUs;        // the hedges pointing to (from) it
+    };
+    std::unordered_map< UniqueId, Boundary > boundaries;
+    auto outside = [&](const UniqueId& otherId) -> bool { return exists(otherId) && !matched.count(otherId); };
+    auto distinct = [](Hyperedges& ids) -> void {
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    };
+    for (const UniqueId& id : matched)
+    {
+        const Hyperedge& hedge(access(id));
+        Boundary& boundary(boundaries[id]);
+        for (const UniqueId& otherId : hedge._to)
+        {
+            if (outside(otherId))
+                boundary.to.push_back(otherId);
+        }
+        for (const UniqueId& otherId : hedge._from)
+        {
+            if (outside(otherId))
+                boundary.from.push_back(otherId);
+        }
+        // NOTE: The caches may contain stale entries, so we have to check them
+        for (const UniqueId& otherId : hedge._toOthers)
+        {
+            if (outside(otherId) && access(otherId).isPointingTo(id))
+                boundary.toUs.push_back(otherId);
+        }
+        for (const UniqueId& otherId : hedge._fromOthers)
+        {
+            if (outside(otherId) && access(otherId).isPointingFrom(id))
+                boundary.fromUs.push_back(otherId);
+        }
+        distinct(boundary.to);
+        distinct(boundary.from);
+        distinct(boundary.toUs);
+        distinct(boundary.fromUs);
+    }
+
+    // Second step: Translate the matched hedges (see rewrite)
+    // m : matchedId -> originalId, partialMap : matchedId -> replacementId
+    Mapping original2new;
+    Mapping replacement2new;
+    std::vector< std::pair< UniqueId, std::string > > produce;   // hedges to be created (or relabeled if preserved)
+    std::unordered_set< UniqueId > produced;
+    const Mapping& original2replacement(join(m, partialMap));
+    for (const auto& pair : original2replacement)
+    {
+        const UniqueId& originalId(pair.first);
+        const UniqueId& replacementId(pair.second);
+        if (!matched.count(originalId))
+        {
+            replacement2new.insert({replacementId, originalId});
+            continue;
+        }
+
+        std::string label(rhs.access(replacementId).label());
+        if (label.empty())
+            label = access(originalId).label();
+
+        UniqueId uid(originalId);
+        // ... multiple originals shall be replaced by one. Then we have to map to the SAME UID (merge)
+        Mapping::const_iterator it(replacement2new.find(replacementId));
+        if (it != replacement2new.end())
+            uid = it->second;
+        // ... one original shall be replaced by multiple replacements
+        if (original2new.find(originalId) != original2new.end())
+            uid = originalId + replacementId;
+
+        // A uid taken by a hedge outside of the match (or produced before) maps to that hedge
+        if (!outside(uid) && !produced.count(uid))
+        {
+            produce.push_back({uid, label});
+            produced.insert(uid);
+        }
+        original2new.insert({originalId, uid});
+        replacement2new.insert({replacementId, uid});
+    }
+
+    // Third step: Drop all wiring of the matched hedges and delete the ones which are not preserved
+    for (const UniqueId& id : matched)
+    {
+        disconnect(id);
+        Hyperedge& hedge(access(id));
+        hedge._to.clear();
+        hedge._from.clear();
+        hedge._toOthers.clear();
+        hedge._fromOthers.clear();
+    }
+    for (const UniqueId& id : matched)
+    {
+        if (!produced.count(id))
+            destroy(id);
+    }
+    for (const auto& pair : produce)
+    {
+        if (exists(pair.first))
+            access(pair.first).label(pair.second);
+        else
+            create(pair.first, pair.second);
+    }
+
+    // Fourth step: Now all hedges in rhs which are not in the graph yet, have to be created
+    const Mapping& rInv(invert(partialMap));
+    for (const UniqueId& replacementId : rhs.findByLabel())
+    {
+        if (rInv.count(replacementId))
+            continue;
+        // If uid is already taken, it will map to the same element
+        create(replacementId, rhs.access(replacementId).label());
+        replacement2new.insert({replacementId, replacementId});
+    }
+
+    // Fifth step: Wiring
+    auto wireTo = [&](const UniqueId& a, const UniqueId& b) -> void {
+        if (!access(a).isPointingTo(b))
+            pointsTo(Hyperedges{a}, Hyperedges{b});
+    };
+    auto wireFrom = [&](const UniqueId& a, const UniqueId& b) -> void {
+        if (!access(a).isPointingFrom(b))
+            pointsFrom(Hyperedges{a}, Hyperedges{b});
+    };
+    // A) Translate the boundary of the original hedges
+    for (const auto& pair : original2new)
+    {
+        const Boundary& boundary(boundaries[pair.first]);
+        const UniqueId& uid(pair.second);
+        for (const UniqueId& otherId : boundary.to)
+            wireTo(uid, otherId);
+        for (const UniqueId& otherId : boundary.from)
+            wireFrom(uid, otherId);
+        for (const UniqueId& otherId : boundary.toUs)
+            wireTo(otherId, uid);
+        for (const UniqueId& otherId : boundary.fromUs)
+            wireFrom(otherId, uid);
+    }
+    // B) Reconstruct wiring of the replacement graph
+    for (auto srcPair = replacement2new.begin(); srcPair != replacement2new.end(); srcPair++)
+    {
+        for (auto destPair = srcPair; destPair != replacement2new.end(); destPair++)
+        {
+            const UniqueId& firstIdOld(srcPair->first);
+            const UniqueId& secondIdOld(destPair->first);
+            if (rhs.access(firstIdOld).isPointingTo(secondIdOld))
+                wireTo(srcPair->second, destPair->second);
+            if (rhs.access(secondIdOld).isPointingTo(firstIdOld))
+                wireTo(destPair->second, srcPair->second);
+            if (rhs.access(firstIdOld).isPointingFrom(secondIdOld))
+                wireFrom(srcPair->second, destPair->second);
+            if (rhs.access(secondIdOld).isPointingFrom(firstIdOld))
+                wireFrom(destPair->second, srcPair->second);
+        }
+    }
+
+    Hyperedges result;
+    for (const auto& pair : replacement2new)
+    {
+        if (pair.second != Zero)
+            result.push_back(pair.second);
+    }
+    distinct(result);
+    return result;
+}
+
+std::ostream& operator<< (std::ostream& os , const Mapping& val)
+{
+    os << "{ ";
+    for (const auto &pair : val)
+    {
+        os << "(" << pair.first << " , " << pair.second << ") ";
+    }
+    os << "} ";
+    return os;
+}
+
+Mapping::iterator Mapping::insert(const value_type& pair)
+{
+    // Fast path: appending in order
+    if (_pairs.empty() || !(pair.first < _pairs.back().first))
+    {
+        _pairs.push_back(pair);
+        return _pairs.end() - 1;
+    }
+    auto it(std::upper_bound(_pairs.begin(), _pairs.end(), pair, [](const value_type& a, const value_type& b) -> bool { return a.first < b.first; }));
+    return _pairs.insert(it, pair);
+}
+
+Mapping::iterator Mapping::erase(const_iterator position)
+{
+    return _pairs.erase(_pairs.begin() + (position - _pairs.cbegin()));
+}
+
+Mapping::const_iterator Mapping::find(const UniqueId& id) const
+{
+    auto it(std::lower_bound(_pairs.begin(), _pairs.end(), id, [](const value_type& a, const UniqueId& b) -> bool { return a.first < b; }));
+    return ((it != _pairs.end()) && (it->first == id)) ? it : _pairs.end();
+}
+
+std::size_t Mapping::count(const UniqueId& id) const
+{
+    const auto& range(equal_range(id));
+    return range.second - range.first;
+}
+
+std::pair< Mapping::const_iterator, Mapping::const_iterator > Mapping::equal_range(const UniqueId& id) const
+{
+    auto first(std::lower_bound(_pairs.begin(), _pairs.end(), id, [](const value_type& a, const UniqueId& b) -> bool { return a.first < b; }));
+    auto last(std::upper_bound(first, _pairs.cend(), id, [](const UniqueId& a, const value_type& b) -> bool { return a < b.first; }));
+    return {first, last};
+}
+
+void Mapping::order()
+{
+    std::stable_sort(_pairs.begin(), _pairs.end(), [](const value_type& a, const value_type& b) -> bool { return a.first < b.first; });
+}
+
+Mapping fromHyperedges(const Hyperedges& a)
+{
+    std::vector< Mapping::value_type > pairs;
+    pairs.reserve(a.size());
+    for (const UniqueId& id : a)
+    {
+        pairs.push_back({id, id});
+    }
+    return Mapping(pairs.begin(), pairs.end());
+}
+
+bool equal(const Mapping& a, const Mapping& b)
+{
+    // For two mappings to be equal, they
+    // a) have to have the same size
+    if (a.size() != b.size())
+        return false;
+    // b) have to contain the same pairs. Both are ordered by the first id, so only pairs with the same first id can be in a different order.
+    if (a == b)
+        return true;
+    std::vector< Mapping::value_type > pairsA(a.begin(), a.end());
+    std::vector< Mapping::value_type > pairsB(b.begin(), b.end());
+    std::sort(pairsA.begin(), pairsA.end());
+    std::sort(pairsB.begin(), pairsB.end());
+    return pairsA == pairsB;
+}
+
+Mapping invert(const Mapping& m)
+{
+    std::vector< Mapping::value_type > pairs;
+    pairs.reserve(m.size());
+    for (const auto &pair : m)
+    {
+        pairs.push_back({pair.second, pair.first});
+    }
+    return Mapping(pairs.begin(), pairs.end());
+}
+
+Mapping join(const Mapping& a, const Mapping& b)
+{
+    // Merge join: Both are ordered by the first id, so we walk through the runs of equal first ids in both
+    std::vector< Mapping::value_type > pairs;
+    auto itA(a.begin());
+    auto itB(b.begin());
+    while ((itA != a.end()) && (itB != b.end()))
+    {
+        if (itA->first < itB->first)
+        {
+            itA++;
+            continue;
+        }
+        if (itB->first < itA->first)
+        {
+            itB++;
+            continue;
+        }
+        // In case of a multimap, we have to pair all occurences of a.first in a and b
+        auto endA(itA);
+        while ((endA != a.end()) && (endA->first == itA->first))
+            endA++;
+        auto endB(itB);
+        while ((endB != b.end()) && (endB->first == itB->first))
+            endB++;
+        for (; itA != endA; itA++)
+        {
+            for (auto otherPair(itB); otherPair != endB; otherPair++)
+                pairs.push_back({itA->second, otherPair->second});
+        }
+        itB = endB;
+    }
+    return Mapping(pairs.begin(), pairs.end());
+}
+
+bool equal(const HashMapping& a, const HashMapping& b)
+{
+    if (a.size() != b.size())
+        return false;
+    // Every pair has to occur as often in b as in a
+    for (auto it = a.begin(); it != a.end(); )
+    {
+        const auto& rangeA(a.equal_range(it->first));
+        const auto& rangeB(b.equal_range(it->first));
+        Hyperedges valuesA, valuesB;
+        for (auto pair = rangeA.first; pair != rangeA.second; pair++)
+            valuesA.push_back(pair->second);
+        for (auto pair = rangeB.first; pair != rangeB.second; pair++)
+            valuesB.push_back(pair->second);
+        std::sort(valuesA.begin(), valuesA.end());
+        std::sort(valuesB.begin(), valuesB.end());
+        if (valuesA != valuesB)
+            return false;
+        it = rangeA.second;
+    }
+    return true;
+}
+
+HashMapping invert(const HashMapping& m)
+{
+    HashMapping result(m.size());
+    for (const auto &pair : m)
+    {
+        result.insert({pair.second, pair.first});
+    }
+    return result;
+}
+
+HashMapping join(const HashMapping& a, const HashMapping& b)
+{
+    HashMapping result;
+    for (const auto& pair : a)
+    {
+        const auto& range(b.equal_range(pair.first));
+        for (auto otherPair = range.first; otherPair != range.second; otherPair++)
+            result.insert({pair.second, otherPair->second});
     }
     return result;
 }
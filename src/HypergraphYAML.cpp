@@ -56,4 +56,12 @@ std::string StringFrom(const Hypergraph& g)
     return out.c_str();
 }
 
+std::string StringFrom(const CompiledPattern& p)
+{
+    Node doc(p);
+    Emitter out;
+    writeNode(doc, out);
+    return out.c_str();
+}
+
 }
@@ -0,0 +1,365 @@
+#include "MultiPattern.hpp"
+#include "CompactHypergraph.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+#include <climits>
+#include <chrono>
+#include <bitset>
+
+// The constraints of hedge id at position to the positions mapped before (see CompiledPattern::plan), sorted
+static CompiledPattern::Constraints constraintsOf(const Hypergraph& query, const Hyperedges& order,
+                                                  const std::unordered_map< UniqueId, unsigned >& positionOf, const UniqueId& id)
+{
+    const unsigned position(order.size());
+    CompiledPattern::Constraints result;
+    auto positionOrSelf = [&](const UniqueId& otherId) -> unsigned {
+        if (otherId == id)
+            return position;
+        auto it(positionOf.find(otherId));
+        return (it != positionOf.end()) ? it->second : UINT_MAX;
+    };
+    for (const UniqueId& otherId : query.access(id).pointingTo())
+    {
+        const unsigned j(positionOrSelf(otherId));
+        if (j != UINT_MAX)
+            result.push_back({j, CompiledPattern::TO});
+    }
+    for (const UniqueId& otherId : query.access(id).pointingFrom())
+    {
+        const unsigned j(positionOrSelf(otherId));
+        if (j != UINT_MAX)
+            result.push_back({j, CompiledPattern::FROM});
+    }
+    for (unsigned j = 0; j < position; j++)
+    {
+        if (query.access(order[j]).isPointingTo(id))
+            result.push_back({j, CompiledPattern::IN_TO});
+        if (query.access(order[j]).isPointingFrom(id))
+            result.push_back({j, CompiledPattern::IN_FROM});
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+MultiPattern::MultiPattern(const std::vector< Hypergraph >& queries)
+: _queries(queries)
+{
+    _nodes.push_back(Node());
+    _orders.resize(_queries.size());
+    _paths.resize(_queries.size());
+    for (unsigned q = 0; q < _queries.size(); q++)
+    {
+        const Hypergraph& query(_queries[q]);
+        // The order the query would use on its own (see CompiledPattern)
+        const Hyperedges own(CompiledPattern(query).order());
+        std::unordered_map< UniqueId, Hyperedges > neighbours;
+        for (const UniqueId& id : own)
+        {
+            Hyperedges others(query.allNeighboursOf(Hyperedges{id}));
+            std::sort(others.begin(), others.end());
+            others.erase(std::unique(others.begin(), others.end()), others.end());
+            others.erase(std::remove(others.begin(), others.end(), id), others.end());
+            neighbours[id] = others;
+        }
+
+        Hyperedges& order(_orders[q]);
+        std::unordered_map< UniqueId, unsigned > positionOf;
+        auto connected = [&](const UniqueId& id) -> bool {
+            for (const UniqueId& otherId : neighbours[id])
+            {
+                if (positionOf.count(otherId))
+                    return true;
+            }
+            return false;
+        };
+        unsigned current = 0;
+        while (order.size() < own.size())
+        {
+            // Keep the search connected: If an unmapped hedge is connected to the mapped ones, the next one has to be
+            bool connectable = false;
+            for (const UniqueId& id : own)
+                connectable = connectable || (!positionOf.count(id) && connected(id));
+
+            // Follow an existing node if one of the remaining hedges fits
+            UniqueId chosen;
+            unsigned next = 0;
+            for (const unsigned child : _nodes[current].children)
+            {
+                for (const UniqueId& id : own)
+                {
+                    if (positionOf.count(id) || (connectable && !connected(id)))
+                        continue;
+                    if (query.access(id).label() != _nodes[child].label)
+                        continue;
+                    if (constraintsOf(query, order, positionOf, id) != _nodes[child].constraints)
+                        continue;
+                    chosen = id;
+                    next = child;
+                    break;
+                }
+                if (next)
+                    break;
+            }
+            // ... otherwise branch off using the own order
+            if (!next)
+            {
+                for (const UniqueId& id : own)
+                {
+                    if (positionOf.count(id) || (connectable && !connected(id)))
+                        continue;
+                    chosen = id;
+                    break;
+                }
+                Node node;
+                node.label = query.access(chosen).label();
+                node.constraints = constraintsOf(query, order, positionOf, chosen);
+                node.depth = order.size();
+                node.lookAhead = UINT_MAX;
+                next = _nodes.size();
+                _nodes.push_back(node);
+                _nodes[current].children.push_back(next);
+            }
+
+            positionOf[chosen] = order.size();
+            order.push_back(chosen);
+            unsigned unmapped = 0;
+            for (const UniqueId& otherId : neighbours[chosen])
+            {
+                if (!positionOf.count(otherId))
+                    unmapped++;
+            }
+            Node& node(_nodes[next]);
+            node.members.push_back({q, chosen});
+            node.lookAheads.push_back(unmapped);
+            node.lookAhead = std::min(node.lookAhead, unmapped);
+            _paths[q].push_back(next);
+            current = next;
+        }
+        _nodes[current].complete.push_back(q);
+    }
+}
+
+unsigned MultiPattern::separatePositions() const
+{
+    unsigned result = 0;
+    for (const Hyperedges& order : _orders)
+        result += order.size();
+    return result;
+}
+
+static bool contains(const HandleRange& range, const Handle h)
+{
+    return std::find(range.begin(), range.end(), h) != range.end();
+}
+
+// A bitmap over the queries
+using Mask = std::vector< unsigned long long >;
+
+// The query hedges of a node with the same candidates
+struct Group
+{
+    std::vector< Handle > hedges;                                   // sorted
+    Mask queries;
+};
+
+MultiMatchSummary MultiPattern::enumerate(const Hypergraph& data, const std::vector< std::unordered_map< UniqueId, Hyperedges > >& candidates,
+                                          const std::function< bool (const unsigned, const Mapping&) >& sink, const MatchOptions& options) const
+{
+    const unsigned words((_queries.size() + 63) / 64);
+    MultiMatchSummary summary;
+    summary.matches.assign(_queries.size(), 0);
+    summary.complete = true;
+    summary.extensions = 0;
+    summary.separateExtensions = 0;
+
+    // Group the candidates of the query hedges at every node
+    const CompactHypergraph snapshot(data);
+    std::vector< std::vector< Group > > groups(_nodes.size());
+    std::vector< std::vector< Handle > > unions(_nodes.size());
+    std::vector< Mask > through(_nodes.size(), Mask(words, 0));
+    unsigned depth = 0;
+    for (unsigned i = 1; i < _nodes.size(); i++)
+    {
+        for (const auto& member : _nodes[i].members)
+        {
+            std::vector< Handle > hedges(snapshot.handles(candidates[member.first].at(member.second)));
+            std::sort(hedges.begin(), hedges.end());
+            hedges.erase(std::unique(hedges.begin(), hedges.end()), hedges.end());
+            auto it(std::find_if(groups[i].begin(), groups[i].end(), [&](const Group& g) -> bool { return g.hedges == hedges; }));
+            if (it == groups[i].end())
+            {
+                groups[i].push_back(Group{hedges, Mask(words, 0)});
+                it = groups[i].end() - 1;
+            }
+            it->queries[member.first / 64] |= 1ULL << (member.first % 64);
+            through[i][member.first / 64] |= 1ULL << (member.first % 64);
+        }
+        for (const Group& group : groups[i])
+        {
+            std::vector< Handle > merged;
+            std::set_union(unions[i].begin(), unions[i].end(), group.hedges.begin(), group.hedges.end(), std::back_inserter(merged));
+            unions[i].swap(merged);
+        }
+        depth = std::max(depth, _nodes[i].depth + 1);
+    }
+
+    // Depth first search through the trie
+    std::vector< Handle > mapped(depth, CompactHypergraph::Invalid);
+    std::vector< bool > used(snapshot.size(), false);
+    std::vector< Mask > alive(depth + 1, Mask(words, 0));
+    for (unsigned q = 0; q < _queries.size(); q++)
+        alive[0][q / 64] |= 1ULL << (q % 64);
+    // The queries which would have built the current partial match on their own: A shared node prunes by the smallest look-ahead of its members,
+    // but a query matched alone would prune by its own one
+    std::vector< Mask > separate(alive);
+    std::vector< unsigned > maxLookAhead(_nodes.size(), 0);
+    for (unsigned i = 1; i < _nodes.size(); i++)
+    {
+        for (const unsigned lookAhead : _nodes[i].lookAheads)
+            maxLookAhead[i] = std::max(maxLookAhead[i], lookAhead);
+    }
+    const unsigned long long maxResults(options.maxResults ? options.maxResults : ULLONG_MAX);
+    const auto deadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(options.timeBudget));
+    unsigned long long passed = 0;
+    bool stopped = false;
+
+    std::function< void (const unsigned) > search = [&](const unsigned index) {
+        const Node& node(_nodes[index]);
+        const unsigned position(node.depth);
+        // Select the smallest candidate range (see MatchState::open)
+        bool local = false;
+        HandleRange range{nullptr, nullptr};
+        for (const auto& constraint : node.constraints)
+        {
+            if (constraint.first == position)
+                continue;
+            const Handle image(mapped[constraint.first]);
+            const HandleRange& neighbours(((constraint.second == CompiledPattern::TO) || (constraint.second == CompiledPattern::IN_FROM)) ? snapshot.previous(image) : snapshot.next(image));
+            if (!local || (neighbours.size() < range.size()))
+            {
+                range = neighbours;
+                local = true;
+            }
+        }
+        if (!local)
+            range = HandleRange{unions[index].data(), unions[index].data() + unions[index].size()};
+
+        Mask& valid(alive[position + 1]);
+        for (const Handle candidate : range)
+        {
+            if (stopped)
+                return;
+            if (used[candidate])
+                continue;
+            // The queries which can map their hedge to the candidate
+            std::fill(valid.begin(), valid.end(), 0);
+            for (const Group& group : groups[index])
+            {
+                if (!std::binary_search(group.hedges.begin(), group.hedges.end(), candidate))
+                    continue;
+                for (unsigned w = 0; w < words; w++)
+                    valid[w] |= group.queries[w];
+            }
+            bool any = false;
+            for (unsigned w = 0; w < words; w++)
+            {
+                valid[w] &= alive[position][w];
+                any = any || valid[w];
+            }
+            if (!any)
+                continue;
+            bool feasible = true;
+            for (const auto& constraint : node.constraints)
+            {
+                const Handle image((constraint.first == position) ? candidate : mapped[constraint.first]);
+                switch (constraint.second)
+                {
+                    case CompiledPattern::TO:
+                        feasible = contains(snapshot.pointingTo(candidate), image);
+                        break;
+                    case CompiledPattern::FROM:
+                        feasible = contains(snapshot.pointingFrom(candidate), image);
+                        break;
+                    case CompiledPattern::IN_TO:
+                        feasible = contains(snapshot.pointingTo(image), candidate);
+                        break;
+                    case CompiledPattern::IN_FROM:
+                        feasible = contains(snapshot.pointingFrom(image), candidate);
+                        break;
+                }
+                if (!feasible)
+                    break;
+            }
+            if (!feasible)
+                continue;
+            // Look-ahead: Every unmapped neighbour of the query hedge needs its own unused neighbour of the candidate
+            unsigned unused = 0;
+            for (const Handle neighbour : snapshot.neighbours(candidate))
+            {
+                if (unused >= maxLookAhead[index])
+                    break;
+                if ((neighbour != candidate) && !used[neighbour])
+                    unused++;
+            }
+            if (unused < node.lookAhead)
+                continue;
+
+            summary.extensions++;
+            Mask& own(separate[position + 1]);
+            std::fill(own.begin(), own.end(), 0);
+            for (unsigned k = 0; k < node.members.size(); k++)
+            {
+                const unsigned q(node.members[k].first);
+                if (node.lookAheads[k] <= unused)
+                    own[q / 64] |= valid[q / 64] & separate[position][q / 64] & (1ULL << (q % 64));
+            }
+            for (unsigned w = 0; w < words; w++)
+                summary.separateExtensions += std::bitset< 64 >(own[w]).count();
+            if (options.timeBudget && !(summary.extensions % 1024) && (std::chrono::steady_clock::now() > deadline))
+            {
+                stopped = true;
+                return;
+            }
+
+            // Extend
+            mapped[position] = candidate;
+            used[candidate] = true;
+            for (const unsigned q : node.complete)
+            {
+                if (!(valid[q / 64] & (1ULL << (q % 64))))
+                    continue;
+                summary.matches[q]++;
+                passed++;
+                if (!options.countOnly)
+                {
+                    Mapping mapping;
+                    for (unsigned i = 0; i < _orders[q].size(); i++)
+                        mapping.insert({_orders[q][i], snapshot.id(mapped[i])});
+                    stopped = stopped || !sink(q, mapping);
+                }
+                stopped = stopped || (passed >= maxResults);
+                if (stopped)
+                    break;
+            }
+            for (const unsigned child : node.children)
+            {
+                if (stopped)
+                    break;
+                bool reachable = false;
+                for (unsigned w = 0; w < words; w++)
+                    reachable = reachable || (valid[w] & through[child][w]);
+                if (reachable)
+                    search(child);
+            }
+            used[candidate] = false;
+        }
+    };
+    for (const unsigned child : _nodes[0].children)
+    {
+        if (!stopped)
+            search(child);
+    }
+    summary.complete = !stopped;
+    return summary;
+}
@@ -0,0 +1,226 @@
+#include "RewriteEngine.hpp"
+#include "StandingQueries.hpp"
+#include "Parallel.hpp"
+
+#include <unordered_set>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <climits>
+#include <chrono>
+
+RewriteEngine::RewriteEngine(const std::vector< RewriteRule >& rules)
+: _rules(rules)
+{
+    for (const RewriteRule& rule : _rules)
+    {
+        _radii.push_back(StandingQueries::radiusOf(rule.lhs));
+        const Mapping& rInv(invert(rule.partialMap));
+        Hyperedges created;
+        for (const UniqueId& id : rule.rhs.findByLabel())
+        {
+            if ((id != Hypergraph::Zero) && !rInv.count(id))
+                created.push_back(id);
+        }
+        _created.push_back(created);
+    }
+}
+
+std::vector< std::vector< Mapping > > RewriteEngine::matchRules(const Hypergraph& data, const Hyperedges* region, const unsigned threads) const
+{
+    std::vector< std::vector< Mapping > > result(_rules.size());
+    const Hypergraph local(region ? data.subgraph(*region) : Hypergraph());
+    // Every embedding only once (instead of once per automorphism of lhs)
+    MatchOptions options;
+    options.symmetryBreaking = true;
+    // NOTE: The graphs are not changed while matching, so the rules can be matched concurrently
+    parallelForEachTask(0, _rules.size(), threads, [&](const unsigned r, const unsigned) -> bool {
+        auto sink = [&](const Mapping& embedding) -> bool {
+            result[r].push_back(embedding);
+            return true;
+        };
+        if (!region || (_radii[r] == UINT_MAX))
+        {
+            data.matchAll(_rules[r].lhs, sink, options);
+            return true;
+        }
+        // Match within the region only. A lhs hedge found in the data graph can only be matched to itself, even if it lies outside of the region.
+        auto matchFunc = [&](const Hypergraph& graph, const Hyperedge& queryHedge) -> Hyperedges {
+            if (data.exists(queryHedge.id()) && !graph.exists(queryHedge.id()))
+                return Hyperedges();
+            return Hypergraph::defaultMatchFunc(graph, queryHedge);
+        };
+        local.matchAll(_rules[r].lhs, sink, options, matchFunc);
+        return true;
+    });
+    return result;
+}
+
+Hypergraph RewriteEngine::instantiate(const unsigned r, const Mapping& embedding, const Hypergraph& data) const
+{
+    const RewriteRule& rule(_rules[r]);
+    if (_created[r].empty())
+        return rule.rhs;
+
+    // Derive the fresh ids from the matched hedges (see Conceptgraph::relate)
+    std::unordered_map< UniqueId, UniqueId > renamed;
+    std::unordered_set< UniqueId > taken;
+    for (const UniqueId& id : _created[r])
+    {
+        if (data.exists(id))
+            continue;
+        UniqueId freshId(id);
+        for (const auto& pair : embedding)
+        {
+            auto myHash(std::hash<UniqueId>{}(freshId));
+            auto newHash(std::hash<UniqueId>{}(pair.second));
+            freshId = std::to_string(myHash ^ (newHash << 1));
+        }
+        // Re-hash in case of an (unlikely) collision
+        while (data.exists(freshId) || rule.rhs.exists(freshId) || taken.count(freshId))
+        {
+            auto myHash(std::hash<UniqueId>{}(freshId));
+            auto newHash(std::hash<UniqueId>{}(id));
+            freshId = std::to_string(myHash ^ (newHash << 1));
+        }
+        taken.insert(freshId);
+        renamed[id] = freshId;
+    }
+    auto rename = [&](const UniqueId& id) -> UniqueId {
+        auto it(renamed.find(id));
+        return (it != renamed.end()) ? it->second : id;
+    };
+
+    Hypergraph result;
+    const Hyperedges& ids(rule.rhs.findByLabel());
+    for (const UniqueId& id : ids)
+        result.create(rename(id), rule.rhs.access(id).label());
+    for (const UniqueId& id : ids)
+    {
+        for (const UniqueId& otherId : rule.rhs.access(id).pointingTo())
+            result.pointsTo(Hyperedges{rename(id)}, Hyperedges{rename(otherId)});
+        for (const UniqueId& otherId : rule.rhs.access(id).pointingFrom())
+            result.pointsFrom(Hyperedges{rename(id)}, Hyperedges{rename(otherId)});
+    }
+    return result;
+}
+
+RewriteSummary RewriteEngine::run(Hypergraph& data, const RewriteOptions& options) const
+{
+    const auto start(std::chrono::steady_clock::now());
+    const auto deadline(start + std::chrono::milliseconds(options.timeBudget));
+    RewriteSummary summary;
+    summary.firings.assign(_rules.size(), 0);
+    summary.total = 0;
+    summary.rounds = 0;
+    summary.conflicts = 0;
+    summary.fixpoint = true;
+
+    // Record our own changes, but pass them on to the log recording before
+    ChangeLog* forward(data.log());
+    ChangeLog changes;
+    data.record(&changes);
+    auto flush = [&]() {
+        if (forward)
+            forward->insert(forward->end(), changes.begin(), changes.end());
+        changes.clear();
+    };
+
+    unsigned regionRadius = 0;
+    for (const unsigned radius : _radii)
+    {
+        if (radius != UINT_MAX)
+            regionRadius = std::max(regionRadius, radius);
+    }
+    std::set< std::pair< unsigned, Mapping > > fired;
+    Hyperedges region;
+    bool first = true;
+    while (true)
+    {
+        summary.rounds++;
+        // I. Determine the region affected by the previous round
+        if (!first)
+        {
+            std::unordered_set< UniqueId > changed;
+            for (const Change& change : changes)
+            {
+                changed.insert(change.ids.begin(), change.ids.end());
+                changed.insert(change.others.begin(), change.others.end());
+            }
+            changed.erase(Hypergraph::Zero);
+            Hyperedges seeds;
+            for (const UniqueId& id : changed)
+            {
+                if (data.exists(id))
+                    seeds.push_back(id);
+            }
+            std::sort(seeds.begin(), seeds.end());
+            region = seeds.empty() ? Hyperedges() : data.neighbourhood(seeds, regionRadius, Hypergraph::BOTH);
+        }
+        flush();
+
+        // II. Match all rules
+        const std::vector< std::vector< Mapping > >& matches(matchRules(data, first ? nullptr : &region, options.threads));
+        first = false;
+
+        // III. Apply the matches which do not overlap
+        std::vector< Firing > batch;
+        std::unordered_set< UniqueId > used;
+        for (unsigned r = 0; r < _rules.size(); r++)
+        {
+            for (const Mapping& embedding : matches[r])
+            {
+                if (fired.count({r, embedding}))
+                    continue;
+                bool overlaps = false;
+                for (const auto& pair : embedding)
+                    overlaps = overlaps || ((pair.second != Hypergraph::Zero) && used.count(pair.second));
+                if (overlaps)
+                {
+                    summary.conflicts++;
+                    continue;
+                }
+                for (const auto& pair : embedding)
+                {
+                    if (pair.second != Hypergraph::Zero)
+                        used.insert(pair.second);
+                }
+                batch.push_back(Firing{r, embedding});
+            }
+        }
+        if (batch.empty())
+            break;
+        // NOTE: Disjoint matches can still interfere: A rewrite also rewires the hedges at the boundary of its match
+        // and rhs hedges can refer to existing hedges outside of the match. So every match gets checked again before it is applied.
+        // The ones which do not hold anymore lie in the changed region and get matched again in the next round.
+        for (const Firing& firing : batch)
+        {
+            if (options.maxFirings && (summary.total >= options.maxFirings))
+            {
+                summary.fixpoint = false;
+                break;
+            }
+            if (!StandingQueries::holds(data, _rules[firing.rule].lhs, firing.embedding))
+            {
+                summary.conflicts++;
+                continue;
+            }
+            data.rewriteInPlace(firing.embedding, instantiate(firing.rule, firing.embedding, data), _rules[firing.rule].partialMap);
+            fired.insert({firing.rule, firing.embedding});
+            summary.firings[firing.rule]++;
+            summary.total++;
+        }
+        if (!summary.fixpoint)
+            break;
+        if (options.timeBudget && (std::chrono::steady_clock::now() > deadline))
+        {
+            summary.fixpoint = false;
+            break;
+        }
+    }
+
+    flush();
+    data.record(forward);
+    summary.seconds = std::chrono::duration< double >(std::chrono::steady_clock::now() - start).count();
+    return summary;
+}
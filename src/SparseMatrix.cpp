@@ -0,0 +1,97 @@
+#include "SparseMatrix.hpp"
+
+#include <algorithm>
+
+SparseVector::SparseVector(const unsigned n, const std::vector< Handle >& nonZeros)
+: size(n),
+  indices(nonZeros)
+{
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+}
+
+SparseMatrix::SparseMatrix(const unsigned r, const unsigned c)
+: rows(r),
+  cols(c),
+  offsets(r + 1, 0)
+{
+}
+
+SparseMatrix SparseMatrix::transposed() const
+{
+    // Counting sort by column. Since we visit the rows in order, the new rows stay sorted.
+    SparseMatrix result(cols, rows);
+    for (const Handle c : indices)
+        result.offsets[c + 1]++;
+    for (unsigned c = 0; c < cols; c++)
+        result.offsets[c + 1] += result.offsets[c];
+    result.indices.resize(indices.size());
+    result.values.resize(indices.size());
+    std::vector< unsigned > fill(result.offsets.begin(), result.offsets.end() - 1);
+    for (unsigned r = 0; r < rows; r++)
+    {
+        for (unsigned i = offsets[r]; i < offsets[r + 1]; i++)
+        {
+            const unsigned position(fill[indices[i]]++);
+            result.indices[position] = r;
+            result.values[position] = values[i];
+        }
+    }
+    return result;
+}
+
+CoordinateMatrix toCoordinates(const SparseMatrix& m)
+{
+    CoordinateMatrix result;
+    result.rows = m.rows;
+    result.cols = m.cols;
+    result.rowIndices.reserve(m.nonZeros());
+    for (unsigned r = 0; r < m.rows; r++)
+        result.rowIndices.insert(result.rowIndices.end(), m.offsets[r + 1] - m.offsets[r], r);
+    result.colIndices = m.indices;
+    result.values = m.values;
+    return result;
+}
+
+SparseVector multiply(const SparseVector& x, const SparseMatrix& A, const std::vector< bool >& mask, const bool complementMask)
+{
+    // Push based: gather the columns of the rows selected by x, then sort and merge the duplicates.
+    // NOTE: So the costs depend on the non-zeros touched only (no dense accumulator of size A.cols per product)
+    SparseVector y(A.cols);
+    const bool masked(!mask.empty());
+    for (const Handle r : x.indices)
+    {
+        for (unsigned i = A.offsets[r]; i < A.offsets[r + 1]; i++)
+        {
+            const Handle c(A.indices[i]);
+            if (masked && (mask[c] == complementMask))
+                continue;
+            y.indices.push_back(c);
+        }
+    }
+    std::sort(y.indices.begin(), y.indices.end());
+    y.indices.erase(std::unique(y.indices.begin(), y.indices.end()), y.indices.end());
+    return y;
+}
+
+std::vector< unsigned > breadthFirstLevels(const SparseMatrix& A, const std::vector< Handle >& sources, const unsigned maxLevel)
+{
+    // frontier<!visited> = frontier * A until the frontier is empty
+    std::vector< unsigned > levels(A.rows, UINT_MAX);
+    std::vector< bool > visited(A.rows, false);
+    SparseVector frontier(A.rows, sources);
+    unsigned level = 0;
+    while (!frontier.indices.empty())
+    {
+        for (const Handle h : frontier.indices)
+        {
+            visited[h] = true;
+            levels[h] = level;
+        }
+        if (level >= maxLevel)
+            break;
+        frontier = multiply(frontier, A, visited, true);
+        level++;
+    }
+    return levels;
+}
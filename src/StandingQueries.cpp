@@ -0,0 +1,219 @@
+#include "StandingQueries.hpp"
+
+#include <unordered_set>
+#include <algorithm>
+
+StandingQueries::StandingQueries(Hypergraph& data)
+: _data(data), _next(0)
+{
+    _data.record(&_log);
+}
+
+StandingQueries::~StandingQueries()
+{
+    if (_data.log() == &_log)
+        _data.record(nullptr);
+}
+
+unsigned StandingQueries::radiusOf(const Hypergraph& query)
+{
+    Hyperedges ids(query.findByLabel());
+    ids.erase(std::remove(ids.begin(), ids.end(), Hypergraph::Zero), ids.end());
+    unsigned radius = 0;
+    for (const UniqueId& id : ids)
+    {
+        // Breadth first search from every query hedge (queries are small)
+        std::unordered_set< UniqueId > visited{id};
+        Hyperedges frontier{id};
+        unsigned distance = 0;
+        while (!frontier.empty())
+        {
+            Hyperedges next;
+            for (const UniqueId& otherId : query.allNeighboursOf(frontier))
+            {
+                if (visited.insert(otherId).second)
+                    next.push_back(otherId);
+            }
+            if (!next.empty())
+                distance++;
+            frontier.swap(next);
+        }
+        if (visited.size() < ids.size())
+            return UINT_MAX;
+        radius = std::max(radius, distance);
+    }
+    return radius;
+}
+
+bool StandingQueries::holds(const Hypergraph& data, const Hypergraph& query, const Mapping& embedding)
+{
+    for (const auto& pair : embedding)
+    {
+        if (!data.exists(pair.second))
+            return false;
+        // A query hedge found in the data graph can only be matched to itself (regardless of its label, see defaultMatchFunc)
+        const bool byId(data.exists(pair.first));
+        if (byId && (pair.first != pair.second))
+            return false;
+        const Hyperedge& queryHedge(query.access(pair.first));
+        const Hyperedge& dataHedge(data.access(pair.second));
+        if (!byId && !queryHedge.label().empty() && (queryHedge.label() != dataHedge.label()))
+            return false;
+        // Every wire of the query has to be mapped to a wire of the data graph
+        for (const UniqueId& toId : queryHedge.pointingTo())
+        {
+            auto it(embedding.find(toId));
+            if ((it == embedding.end()) || !dataHedge.isPointingTo(it->second))
+                return false;
+        }
+        for (const UniqueId& fromId : queryHedge.pointingFrom())
+        {
+            auto it(embedding.find(fromId));
+            if ((it == embedding.end()) || !dataHedge.isPointingFrom(it->second))
+                return false;
+        }
+    }
+    return true;
+}
+
+unsigned long long StandingQueries::discover(Query& query, const Hyperedges* region)
+{
+    unsigned long long found = 0;
+    auto sink = [&](const Mapping& embedding) -> bool {
+        auto result(query.embeddings.insert(embedding));
+        if (!result.second)
+            return true;
+        for (const auto& pair : embedding)
+        {
+            if (pair.second != Hypergraph::Zero)
+                query.byHedge[pair.second].insert(&(*result.first));
+        }
+        query.sink(embedding, true);
+        found++;
+        return true;
+    };
+    if (!region)
+    {
+        _data.matchAll(query.graph, sink);
+        return found;
+    }
+    // Match within the region only. A query hedge found in the data graph can only be matched to itself, even if it lies outside of the region.
+    const Hypergraph local(_data.subgraph(*region));
+    const Hypergraph& data(_data);
+    auto matchFunc = [&](const Hypergraph& graph, const Hyperedge& queryHedge) -> Hyperedges {
+        if (data.exists(queryHedge.id()) && !graph.exists(queryHedge.id()))
+            return Hyperedges();
+        return Hypergraph::defaultMatchFunc(graph, queryHedge);
+    };
+    local.matchAll(query.graph, sink, MatchOptions(), matchFunc);
+    return found;
+}
+
+void StandingQueries::forget(Query& query, const Mapping& embedding)
+{
+    auto it(query.embeddings.find(embedding));
+    if (it == query.embeddings.end())
+        return;
+    for (const auto& pair : embedding)
+    {
+        auto entry(query.byHedge.find(pair.second));
+        if (entry == query.byHedge.end())
+            continue;
+        entry->second.erase(&(*it));
+        if (entry->second.empty())
+            query.byHedge.erase(entry);
+    }
+    query.embeddings.erase(it);
+}
+
+unsigned StandingQueries::add(const Hypergraph& query, Sink sink)
+{
+    const unsigned number(_next++);
+    Query& entry(_queries[number]);
+    entry.graph = query;
+    entry.sink = sink;
+    entry.radius = radiusOf(query);
+    discover(entry, nullptr);
+    return number;
+}
+
+void StandingQueries::remove(const unsigned query)
+{
+    _queries.erase(query);
+}
+
+unsigned long long StandingQueries::update()
+{
+    // Collect the changed hedges
+    std::unordered_set< UniqueId > changed;
+    std::unordered_set< UniqueId > createdOrDestroyed;
+    for (const Change& change : _log)
+    {
+        changed.insert(change.ids.begin(), change.ids.end());
+        changed.insert(change.others.begin(), change.others.end());
+        if ((change.kind == Change::CREATE) || (change.kind == Change::DESTROY))
+            createdOrDestroyed.insert(change.ids.begin(), change.ids.end());
+    }
+    _log.clear();
+    changed.erase(Hypergraph::Zero);
+    if (changed.empty())
+        return 0;
+    Hyperedges seeds;
+    for (const UniqueId& id : changed)
+    {
+        if (_data.exists(id))
+            seeds.push_back(id);
+    }
+    std::sort(seeds.begin(), seeds.end());
+
+    unsigned long long events = 0;
+    Hyperedges region;
+    unsigned regionRadius = UINT_MAX;
+    for (auto& pair : _queries)
+    {
+        Query& query(pair.second);
+        // A query hedge matches by id or by label depending on the existence of a data hedge with the same id.
+        // If such a hedge got created or destroyed, all embeddings can be affected.
+        bool rebound = false;
+        for (const UniqueId& id : createdOrDestroyed)
+            rebound = rebound || query.graph.exists(id);
+        // I. Check the embeddings using a changed hedge
+        std::set< Mapping > affected;
+        if (rebound)
+        {
+            affected = query.embeddings;
+        } else {
+            for (const UniqueId& id : changed)
+            {
+                auto it(query.byHedge.find(id));
+                if (it == query.byHedge.end())
+                    continue;
+                for (const Mapping* embedding : it->second)
+                    affected.insert(*embedding);
+            }
+        }
+        for (const Mapping& embedding : affected)
+        {
+            if (holds(_data, query.graph, embedding))
+                continue;
+            forget(query, embedding);
+            query.sink(embedding, false);
+            events++;
+        }
+        // II. Find the new embeddings around the changed hedges (queries with the same radius share the region)
+        if (seeds.empty() && !rebound)
+            continue;
+        if (rebound || (query.radius == UINT_MAX))
+        {
+            events += discover(query, nullptr);
+            continue;
+        }
+        if (query.radius != regionRadius)
+        {
+            region = _data.neighbourhood(seeds, query.radius, Hypergraph::BOTH);
+            regionRadius = query.radius;
+        }
+        events += discover(query, &region);
+    }
+    return events;
+}
@@ -2,6 +2,7 @@
 #include "catch.hpp"
 #include "CommonConceptGraph.hpp"
 #include "HypergraphYAML.hpp"
+#include "CompactHypergraph.hpp"
 
 #include <iostream>
 
@@ -17,6 +18,30 @@ TEST_CASE("Construct a conceptual graph with fundamental relations", "[CommonCon
     REQUIRE(ccg.concept("CAR","Car") == Hyperedges{"CAR"});
     REQUIRE(ccg.isA(Hyperedges{"PERSON", "CAR"}, Hyperedges{"OBJECT"}).size() == 2);
     REQUIRE(subtract(ccg.subclassesOf(Hyperedges{"OBJECT"}), Hyperedges{"OBJECT", "PERSON", "CAR"}).empty() == true);
+    // multi-source transitive queries
+    REQUIRE(ccg.concept("DRIVER","Driver") == Hyperedges{"DRIVER"});
+    REQUIRE(ccg.isA(Hyperedges{"DRIVER"}, Hyperedges{"PERSON"}).size() == 1);
+    REQUIRE(ccg.subclassesOf(Hyperedges{"OBJECT", "PERSON"}).size() == 4);
+    const HyperedgeLists& perSource(ccg.transitivelyRelatedToEach(Hyperedges{"OBJECT", "PERSON", "CAR"}, Hyperedges{CommonConceptGraph::IsAId}, "", Hypergraph::INVERSE));
+    REQUIRE(perSource.size() == 3);
+    REQUIRE(subtract(perSource.at(0), Hyperedges{"OBJECT", "PERSON", "CAR", "DRIVER"}).empty() == true);
+    REQUIRE(perSource.at(0).size() == 4);
+    REQUIRE(perSource.at(1) == Hyperedges{"PERSON", "DRIVER"});
+    REQUIRE(perSource.at(2) == Hyperedges{"CAR"});
+    // topological order
+    Hyperedges cyclic;
+    const HyperedgeLists& bottomUp(ccg.topologicalOrderOf(Hyperedges{CommonConceptGraph::IsAId}, cyclic));
+    REQUIRE(cyclic.empty() == true);
+    REQUIRE(bottomUp.size() == 3);
+    REQUIRE(bottomUp.at(0) == Hyperedges{"CAR", "DRIVER"});
+    REQUIRE(bottomUp.at(1) == Hyperedges{"PERSON"});
+    REQUIRE(bottomUp.at(2) == Hyperedges{"OBJECT"});
+    REQUIRE(ccg.topologicalOrderOf(Hyperedges{CommonConceptGraph::IsAId}, cyclic, Hypergraph::INVERSE).at(0) == Hyperedges{"OBJECT"});
+    REQUIRE(ccg.concept("ROBOT","Robot") == Hyperedges{"ROBOT"});
+    REQUIRE(ccg.isA(Hyperedges{"ROBOT"}, Hyperedges{"DRIVER"}).size() == 1);
+    REQUIRE(ccg.isA(Hyperedges{"DRIVER"}, Hyperedges{"ROBOT"}).size() == 1);
+    REQUIRE(ccg.topologicalOrderOf(Hyperedges{CommonConceptGraph::IsAId}, cyclic).at(0) == Hyperedges{"CAR"});
+    REQUIRE(cyclic == Hyperedges{"DRIVER", "OBJECT", "PERSON", "ROBOT"});
     // class-instance
     REQUIRE(ccg.instantiateFrom("PERSON", "Mary").size() == 1);
     REQUIRE(ccg.instancesOf(Hyperedges{"PERSON"}).size() == 1);
@@ -33,8 +58,38 @@ TEST_CASE("Construct a conceptual graph with fundamental relations", "[CommonCon
     ccg.factFrom(ccg.instancesOf(Hyperedges{"PERSON"}, "Mary"), ccg.instancesOf(Hyperedges{"PERSON"}, "Jesus"), "LIKES");
     REQUIRE(ccg.relatedTo(ccg.instancesOf(Hyperedges{"PERSON"}, "Mary"), Hyperedges{"LOVES"}).size() == 1);
     REQUIRE(ccg.relatedTo(ccg.instancesOf(Hyperedges{"PERSON"}, "Mary"), Hyperedges{"LIKES"}).size() == 2);
+    // typed queries
+    REQUIRE(ccg.relatedTo<Rel::InstanceOf>(ccg.instancesOf(Hyperedges{"PERSON"}, "Mary")) == Hyperedges{"PERSON"});
+    REQUIRE(ccg.relatedTo<Rel::InstanceOf>(Hyperedges{"PERSON"}, "", Hypergraph::INVERSE).size() == 3);
+    REQUIRE(subtract(ccg.transitivelyRelatedTo<Rel::IsA>(Hyperedges{"OBJECT"}, "", Hypergraph::INVERSE), ccg.subclassesOf(Hyperedges{"OBJECT"})).empty() == true);
+    REQUIRE(ccg.transitivelyRelatedTo<Rel::IsA>(Hyperedges{"OBJECT"}, "Robot", Hypergraph::INVERSE) == Hyperedges{"ROBOT"});
+    REQUIRE(ccg.isFactOf<Rel::IsA>(ccg.factsOf(CommonConceptGraph::IsAId, Hyperedges{"CAR"})[0]) == true);
+    REQUIRE(ccg.isFactOf<Rel::HasA>(ccg.factsOf(CommonConceptGraph::IsAId, Hyperedges{"CAR"})[0]) == false);
+    REQUIRE(ccg.isFactOf<Rel::SubrelOf>(ccg.factsOf(CommonConceptGraph::SubrelOfId, Hyperedges{"LOVES"})[0]) == true);
+    // typed queries follow relations added later on (the resolved relations get cached per state of the graph)
+    const Hyperedges& superclassesOfCar(ccg.relatedTo<Rel::IsA>(Hyperedges{"CAR"}));
+    REQUIRE(ccg.concept("VEHICLE","Vehicle") == Hyperedges{"VEHICLE"});
+    ccg.relate("KIND-OF", Hyperedges{"OBJECT"}, Hyperedges{"OBJECT"}, "kind-of");
+    ccg.subrelationOf(Hyperedges{"KIND-OF"}, Hyperedges{CommonConceptGraph::IsAId});
+    REQUIRE(ccg.factFrom(Hyperedges{"CAR"}, Hyperedges{"VEHICLE"}, "KIND-OF").size() == 1);
+    REQUIRE(ccg.relatedTo<Rel::IsA>(Hyperedges{"CAR"}).size() == superclassesOfCar.size() + 1);
+    REQUIRE(ccg.relatedTo<Rel::IsA>(Hyperedges{"CAR"}) == ccg.relatedTo(Hyperedges{"CAR"}, Hyperedges{CommonConceptGraph::IsAId}));
     // TODO: Part-Whole
-    // TODO: Connectivity
+    // Connectivity & motifs
+    REQUIRE(ccg.concept("A","Port") == Hyperedges{"A"});
+    REQUIRE(ccg.concept("B","Port") == Hyperedges{"B"});
+    REQUIRE(ccg.concept("C","Port") == Hyperedges{"C"});
+    REQUIRE(ccg.connects(Hyperedges{"A"}, Hyperedges{"B", "C"}).size() == 2);
+    REQUIRE(ccg.connects(Hyperedges{"C"}, Hyperedges{"B"}).size() == 1);
+    const CompactHypergraph connections(ccg.factGraphOf(Hyperedges{CommonConceptGraph::ConnectsId}));
+    std::vector< unsigned > trianglesPerHedge;
+    REQUIRE(connections.triangles(trianglesPerHedge, 2) == 1);
+    REQUIRE(trianglesPerHedge[connections.handle("A")] == 1);
+    const CompactHypergraph families(ccg.factGraphOf(Hyperedges{CommonConceptGraph::HasAId}));
+    std::vector< unsigned long long > sharedParents;
+    REQUIRE(families.wedges(sharedParents) == 0);
+    REQUIRE(ccg.hasA(ccg.instancesOf(Hyperedges{"PERSON"}, "Mary"), ccg.instancesOf(Hyperedges{"PERSON"}, "Josef")).size() == 1);
+    REQUIRE(CompactHypergraph(ccg.factGraphOf(Hyperedges{CommonConceptGraph::HasAId})).wedges(sharedParents) == 1);
     // TODO: Test mapping
 }
 
@@ -3,8 +3,54 @@
 #include "Hyperedge.hpp"
 #include "Hypergraph.hpp"
 #include "HypergraphYAML.hpp"
+#include "CompactHypergraph.hpp"
+#include "CandidateIndex.hpp"
+#include "GraphStatistics.hpp"
+#include "StandingQueries.hpp"
+#include "MultiPattern.hpp"
+#include "RewriteEngine.hpp"
 
 #include <iostream>
+#include <cmath>
+#include <algorithm>
+
+// The data graph of the pattern matching tests. Three As and two Bs: a1 -> b1, a2 -> b1, a3 -> b2, b1 -> a3
+static Hypergraph patternData()
+{
+    Hypergraph data;
+    data.create("a1", "A");
+    data.create("a2", "A");
+    data.create("a3", "A");
+    data.create("b1", "B");
+    data.create("b2", "B");
+    data.pointsTo(Hyperedges{"a1", "a2"}, Hyperedges{"b1"});
+    data.pointsTo(Hyperedges{"a3"}, Hyperedges{"b2"});
+    data.pointsTo(Hyperedges{"b1"}, Hyperedges{"a3"});
+    return data;
+}
+
+// The query graph of the pattern matching tests: x:A -> y:B -> z:A
+static Hypergraph patternQuery()
+{
+    Hypergraph query;
+    query.create("x", "A");
+    query.create("y", "B");
+    query.create("z", "A");
+    query.pointsTo(Hyperedges{"x"}, Hyperedges{"y"});
+    query.pointsTo(Hyperedges{"y"}, Hyperedges{"z"});
+    return query;
+}
+
+// All matches of query in data in the order of the sequential search
+static std::vector< Mapping > matchesOf(const Hypergraph& data, const Hypergraph& query)
+{
+    std::vector< Mapping > result;
+    MatchState state;
+    Mapping next;
+    while ((next = data.match(query, state, Hypergraph::defaultMatchFunc)).size())
+        result.push_back(next);
+    return result;
+}
 
 TEST_CASE("Construct an hypergraph", "[Hypergraph]")
 {
@@ -16,7 +62,10 @@ TEST_CASE("Construct an hypergraph", "[Hypergraph]")
     REQUIRE(hg.create("1", "My first hedge").empty() == false);
     REQUIRE(hg.access("1").id() == "1");
     REQUIRE(hg.access("1").label() == "My first hedge");
+    const unsigned long long version(hg.version());
     REQUIRE(hg.create("2", "My second hedge").empty() == false);
+    REQUIRE(hg.version() != version);
+    REQUIRE(Hypergraph(hg).version() != hg.version());
     REQUIRE(hg.findByLabel().size() == 3);
     REQUIRE(hg.findByLabel("My first hedge").size() == 1);
     REQUIRE(hg.pointsTo(Hyperedges{"1"}, Hyperedges{"2"}).size() == 2);
@@ -29,13 +78,603 @@ TEST_CASE("Construct an hypergraph", "[Hypergraph]")
     REQUIRE(hg.create("3", "My hedge with properties", Properties{{"property1", "value1"}, {"property2", "value2"}}).empty() == false);
     REQUIRE(hg.access("3").hasProperty("property1") == true);
     REQUIRE(hg.access("3").property("property2") == "value2");
-    // TODO: Test pattern matching
+    SECTION("Neighbourhood")
+    {
+        // 1 -> 2 -> 4 -> 5 and a hub 6 pointing to everybody
+        REQUIRE(hg.create("4", "4").empty() == false);
+        REQUIRE(hg.create("5", "5").empty() == false);
+        REQUIRE(hg.create("6", "hub").empty() == false);
+        hg.pointsTo(Hyperedges{"2"}, Hyperedges{"4"});
+        hg.pointsTo(Hyperedges{"4"}, Hyperedges{"5"});
+        REQUIRE(hg.neighbourhood(Hyperedges{"1"}, 0) == Hyperedges{"1"});
+        REQUIRE(hg.neighbourhood(Hyperedges{"1"}, 2, Hypergraph::FORWARD) == Hyperedges{"1", "2", "4"});
+        REQUIRE(hg.neighbourhood(Hyperedges{"5"}, 2, Hypergraph::INVERSE) == Hyperedges{"5", "4", "2"});
+        REQUIRE(hg.neighbourhood(Hyperedges{"1"}, 10, Hypergraph::BOTH, "", 3) == Hyperedges{"1", "2", "4"});
+        hg.pointsTo(Hyperedges{"6"}, Hyperedges{"1", "2", "3", "4", "5"});
+        REQUIRE(hg.neighbourhood(Hyperedges{"3"}, 2).size() == 6);
+        REQUIRE(hg.neighbourhood(Hyperedges{"3"}, 2, Hypergraph::BOTH, "", UINT_MAX, 4) == Hyperedges{"3", "6"});
+        const Hypergraph& ego(hg.subgraph(hg.neighbourhood(Hyperedges{"2"}, 1, Hypergraph::FORWARD)));
+        REQUIRE(ego.size() == 3);
+        REQUIRE(ego.isPointingTo(Hyperedges{"2"}) == Hyperedges{"4"});
+        REQUIRE(ego.isPointingTo(Hyperedges{"4"}).empty() == true);
+    }
+    SECTION("Connected components")
+    {
+        const HyperedgeLists& weak(hg.weaklyConnectedComponents());
+        REQUIRE(weak.size() == 3);
+        REQUIRE(weak.at(0) == Hyperedges{"1", "2"});
+        REQUIRE(weak.at(1) == Hyperedges{"3"});
+        REQUIRE(weak.at(2) == Hyperedges{Hypergraph::Zero});
+        REQUIRE(hg.labelPropagationComponents(2).ids == weak.ids);
+        REQUIRE(hg.stronglyConnectedComponents().size() == 4);
+        hg.pointsFrom(Hyperedges{"1"}, Hyperedges{"2"});
+        const HyperedgeLists& strong(hg.stronglyConnectedComponents());
+        REQUIRE(strong.size() == 3);
+        REQUIRE(strong.at(0) == Hyperedges{"1", "2"});
+    }
+    SECTION("Analytics")
+    {
+        // 1 -> 2 -> 3 -> 1 forms a triangle
+        hg.pointsTo(Hyperedges{"2"}, Hyperedges{"3"});
+        hg.pointsTo(Hyperedges{"3"}, Hyperedges{"1"});
+        REQUIRE(hg.degreeHistogram(Hypergraph::FORWARD) == std::vector< unsigned >{1, 3});
+        REQUIRE(hg.degreeHistogram(Hypergraph::BOTH, 2) == std::vector< unsigned >{1, 0, 3});
+        const std::map< UniqueId, double >& rank(hg.pageRank());
+        REQUIRE(std::fabs(rank.at("1") - rank.at("2")) < 1e-6);
+        REQUIRE(rank.at("1") > rank.at(Hypergraph::Zero));
+        const std::map< UniqueId, unsigned >& cores(hg.coreNumbers());
+        REQUIRE(cores.at("1") == 2);
+        REQUIRE(cores.at(Hypergraph::Zero) == 0);
+    }
+    SECTION("Sparse matrices")
+    {
+        // 1 -> 2 -> 3 and 1 -> 2 once more
+        hg.pointsTo(Hyperedges{"2"}, Hyperedges{"3"});
+        hg.pointsTo(Hyperedges{"1"}, Hyperedges{"2"});
+        const CompactHypergraph compact(hg);
+        const Handle one(compact.handle("1")), two(compact.handle("2")), three(compact.handle("3"));
+        const SparseMatrix& to(compact.csr(CompactHypergraph::POINTING_TO));
+        REQUIRE(to.nonZeros() == 2);
+        REQUIRE(to.indices[to.offsets[one]] == two);
+        REQUIRE(to.values[to.offsets[one]] == 2);
+        const SparseMatrix& toColumns(compact.csc(CompactHypergraph::POINTING_TO));
+        REQUIRE(toColumns.offsets[two + 1] - toColumns.offsets[two] == 1);
+        REQUIRE(toColumns.indices[toColumns.offsets[two]] == one);
+        const CoordinateMatrix& coordinates(compact.coo(CompactHypergraph::POINTING_TO));
+        REQUIRE(coordinates.rowIndices == std::vector< Handle >{one, two});
+        REQUIRE(coordinates.colIndices == std::vector< Handle >{two, three});
+        const SparseMatrix& next(compact.csr());
+        REQUIRE(multiply(SparseVector(compact.size(), {one}), next).indices == std::vector< Handle >{two});
+        std::vector< bool > mask(compact.size(), false);
+        mask[two] = true;
+        REQUIRE(multiply(SparseVector(compact.size(), {one}), next, mask, true).indices.empty() == true);
+        // Columns reached from several rows show up once
+        SparseMatrix converging(3, 3);
+        converging.offsets = std::vector< unsigned >{0, 2, 3, 3};
+        converging.indices = std::vector< Handle >{1, 2, 2};
+        converging.values = std::vector< unsigned >{1, 1, 1};
+        REQUIRE(multiply(SparseVector(3, {0, 1}), converging).indices == std::vector< Handle >{1, 2});
+        const std::vector< unsigned >& levels(breadthFirstLevels(next, {one}));
+        REQUIRE(levels[one] == 0);
+        REQUIRE(levels[three] == 2);
+        REQUIRE(levels[compact.handle(Hypergraph::Zero)] == UINT_MAX);
+    }
+    SECTION("Projections")
+    {
+        // The hedges 1 and 3 both point to 2 and 4, so the only pair of members is 2 - 4 sharing two hedges
+        REQUIRE(hg.create("4", "4").empty() == false);
+        hg.pointsTo(Hyperedges{"1"}, Hyperedges{"4"});
+        hg.pointsTo(Hyperedges{"3"}, Hyperedges{"2", "4"});
+        const CompactHypergraph compact(hg);
+        const Handle two(compact.handle("2")), three(compact.handle("3")), four(compact.handle("4"));
+        const SparseMatrix& incidence(compact.bipartite());
+        REQUIRE(incidence.nonZeros() == 4);
+        REQUIRE(incidence.offsets[three + 1] - incidence.offsets[three] == 2);
+        const SparseMatrix& clique(compact.cliqueExpansion());
+        REQUIRE(clique.nonZeros() == 2);
+        REQUIRE(clique.indices[clique.offsets[two]] == four);
+        REQUIRE(clique.values[clique.offsets[two]] == 2);
+        unsigned streamed = 0;
+        compact.cliqueExpansion([&](const Handle a, const Handle b, const unsigned w) { streamed += w; }, false);
+        REQUIRE(streamed == 2);
+    }
+    SECTION("Sampling")
+    {
+        for (unsigned i = 4; i < 20; i++)
+        {
+            hg.create(std::to_string(i), "sample");
+            hg.pointsTo(Hyperedges{std::to_string(i - 1)}, Hyperedges{std::to_string(i)});
+        }
+        const Hyperedges& uniform(hg.uniformSample(5, 42));
+        REQUIRE(uniform.size() == 5);
+        REQUIRE(unite(uniform, uniform).size() == 5);
+        REQUIRE(hg.uniformSample(5, 42) == uniform);
+        REQUIRE(hg.uniformSample(100).size() == hg.size());
+        const Hyperedges& walked(hg.randomWalkSample(Hyperedges{"4"}, 5, 0.1, Hypergraph::FORWARD, 7));
+        REQUIRE(walked.size() == 5);
+        REQUIRE(walked[0] == "4");
+        REQUIRE(walked == hg.randomWalkSample(Hyperedges{"4"}, 5, 0.1, Hypergraph::FORWARD, 7));
+        const Hyperedges& burnt(hg.forestFireSample(8, 0.7, 3));
+        REQUIRE(burnt.size() == 8);
+        REQUIRE(hg.subgraph(burnt).size() == 8 + (std::find(burnt.begin(), burnt.end(), Hypergraph::Zero) == burnt.end() ? 1 : 0));
+        // Burning everything must terminate
+        REQUIRE(hg.forestFireSample(8, 1.0, 3).size() == 8);
+        REQUIRE(hg.forestFireSample(hg.size(), 1.5).size() == hg.size());
+    }
+    SECTION("Mappings")
+    {
+        // Pairs stay ordered by their first id. Pairs with the same first id keep their insertion order.
+        Mapping m{{"c", "3"}, {"a", "1"}};
+        m.insert({"b", "2"});
+        m.insert({"a", "0"});
+        REQUIRE(m.size() == 4);
+        REQUIRE(m.begin()->second == "1");
+        REQUIRE(m.find("a")->second == "1");
+        REQUIRE(m.find("d") == m.end());
+        REQUIRE(m.count("a") == 2);
+        REQUIRE(m == Mapping{{"a", "1"}, {"a", "0"}, {"b", "2"}, {"c", "3"}});
+        REQUIRE(m != Mapping{{"a", "0"}, {"a", "1"}, {"b", "2"}, {"c", "3"}});
+        REQUIRE(equal(m, Mapping{{"a", "0"}, {"a", "1"}, {"b", "2"}, {"c", "3"}}) == true);
+        REQUIRE(equal(m, Mapping{{"a", "0"}, {"a", "1"}, {"b", "2"}, {"c", "4"}}) == false);
+        const Mapping& inverse(invert(m));
+        REQUIRE(inverse == Mapping{{"0", "a"}, {"1", "a"}, {"2", "b"}, {"3", "c"}});
+        REQUIRE(join(m, Mapping{{"a", "x"}, {"c", "y"}, {"c", "z"}}) == Mapping{{"1", "x"}, {"0", "x"}, {"3", "y"}, {"3", "z"}});
+        m.erase(m.find("b"));
+        REQUIRE(m.count("b") == 0);
+        REQUIRE(fromHyperedges(Hyperedges{"b", "a"}) == Mapping{{"a", "a"}, {"b", "b"}});
+        const HashMapping hashed(m.begin(), m.end());
+        REQUIRE(equal(invert(invert(hashed)), hashed) == true);
+        REQUIRE(equal(join(hashed, HashMapping{{"a", "x"}}), HashMapping{{"1", "x"}, {"0", "x"}}) == true);
+    }
     SECTION("Pattern matching")
     {
+        const Hypergraph data(patternData());
+        const Hypergraph query(patternQuery());
+        for (const Hypergraph::MatchEngine engine : {Hypergraph::ULLMANN, Hypergraph::VF2})
+        {
+            std::stack< Mapping > searchSpace;
+            std::set< UniqueId > sources;
+            unsigned matches = 0;
+            Mapping mapping;
+            while ((mapping = data.match(query, searchSpace, Hypergraph::defaultMatchFunc, engine)).size())
+            {
+                REQUIRE(mapping.size() == 4);
+                REQUIRE(mapping.find(Hypergraph::Zero)->second == Hypergraph::Zero);
+                REQUIRE(mapping.find("y")->second == "b1");
+                REQUIRE(mapping.find("z")->second == "a3");
+                sources.insert(mapping.find("x")->second);
+                matches++;
+            }
+            REQUIRE(matches == 2);
+            REQUIRE(sources == std::set< UniqueId >{"a1", "a2"});
+        }
+        // A match state caches the setup and knows when the search is over
+        MatchState state;
+        unsigned matches = 0;
+        while (data.match(query, state, Hypergraph::defaultMatchFunc).size())
+            matches++;
+        REQUIRE(matches == 2);
+        REQUIRE(state.exhausted() == true);
+        REQUIRE(state.order().size() == 4);
+        REQUIRE(data.match(query, state, Hypergraph::defaultMatchFunc).empty() == true);
+        state.reset();
+        REQUIRE(data.match(query, state, Hypergraph::defaultMatchFunc).size() == 4);
+    }
+    SECTION("Parallel matching")
+    {
+        const Hypergraph data(patternData());
+        const Hypergraph query(patternQuery());
+        const std::vector< Mapping >& sequential(matchesOf(data, query));
+        std::vector< Mapping > ordered;
+        REQUIRE(data.matchParallel(query, Hypergraph::defaultMatchFunc, [&](const Mapping& m) -> bool { ordered.push_back(m); return true; }, 4, true) == 2);
+        REQUIRE(ordered == sequential);
+        REQUIRE(data.matchParallel(query, Hypergraph::defaultMatchFunc, [](const Mapping& m) -> bool { return false; }, 4) == 1);
+    }
+    SECTION("Enumerating matches with limits")
+    {
+        const Hypergraph data(patternData());
+        const Hypergraph query(patternQuery());
+        MatchOptions options;
+        MatchSummary summary(data.matchAll(query, [](const Mapping& m) -> bool { return true; }, options));
+        REQUIRE(summary.matches == 2);
+        REQUIRE(summary.complete == true);
+        options.maxResults = 1;
+        summary = data.matchAll(query, [](const Mapping& m) -> bool { return true; }, options);
+        REQUIRE(summary.matches == 1);
+        REQUIRE(summary.complete == false);
+        options.maxResults = 0;
+        options.countOnly = true;
+        unsigned calls = 0;
+        summary = data.matchAll(query, [&](const Mapping& m) -> bool { calls++; return true; }, options);
+        REQUIRE(summary.matches == 2);
+        REQUIRE(calls == 0);
+    }
+    SECTION("Symmetry breaking")
+    {
+        // Symmetric query: p and r can be swapped, so every embedding is found twice
+        const Hypergraph data(patternData());
+        Hypergraph symmetric;
+        symmetric.create("p", "A");
+        symmetric.create("q", "B");
+        symmetric.create("r", "A");
+        symmetric.pointsTo(Hyperedges{"p", "r"}, Hyperedges{"q"});
+        std::set< Mapping > all, expanded;
+        MatchOptions options;
+        REQUIRE(data.matchAll(symmetric, [&](const Mapping& m) -> bool { all.insert(m); return true; }, options).matches == 2);
+        options.symmetryBreaking = true;
+        REQUIRE(data.matchAll(symmetric, [](const Mapping& m) -> bool { return true; }, options).matches == 1);
+        options.expandSymmetries = true;
+        REQUIRE(data.matchAll(symmetric, [&](const Mapping& m) -> bool { expanded.insert(m); return true; }, options).matches == 2);
+        REQUIRE(expanded == all);
+        options.countOnly = true;
+        REQUIRE(data.matchAll(symmetric, [](const Mapping& m) -> bool { return true; }, options).matches == 2);
+    }
+    SECTION("Candidate index")
+    {
+        // z needs a previous B and y needs a previous and a next A
+        const Hypergraph data(patternData());
+        const Hypergraph query(patternQuery());
+        const CandidateIndex index(data);
+        REQUIRE(CandidateIndex::bucket(0) == 0);
+        REQUIRE(CandidateIndex::bucket(1) == 1);
+        REQUIRE(CandidateIndex::bucket(5) == 3);
+        REQUIRE(index.candidates(query, "x") == Hyperedges{"a1", "a2", "a3"});
+        REQUIRE(index.candidates(query, "y") == Hyperedges{"b1"});
+        REQUIRE(index.candidates(query, "z") == Hyperedges{"a3"});
+        REQUIRE(index.candidates(query, Hypergraph::Zero) == Hyperedges{Hypergraph::Zero});
+        std::vector< Mapping > indexed;
+        data.matchParallel(query, index.matchFunc(query), [&](const Mapping& m) -> bool { indexed.push_back(m); return true; }, 1);
+        REQUIRE(indexed == matchesOf(data, query));
+    }
+    SECTION("Property constraints")
+    {
+        // Only a1 is older than 40 AND points to b1
+        Hypergraph data(patternData());
+        data.access("a1").property("age", "50");
+        data.access("a2").property("age", "20");
+        data.access("a3").property("age", "45");
+        Hypergraph query(patternQuery());
+        query.access("x").property("where", "age > 40");
+        PropertyConstraint constraint;
+        REQUIRE(PropertyConstraint::parse(" age >= 45 ", constraint) == true);
+        REQUIRE(constraint.key == "age");
+        REQUIRE(constraint.op == PropertyConstraint::GREATER_EQUAL);
+        REQUIRE(constraint.value == "45");
+        REQUIRE(PropertyConstraint::parse("age", constraint) == true);
+        REQUIRE(constraint.op == PropertyConstraint::EXISTS);
+        REQUIRE(PropertyConstraint::parse("> 45", constraint) == false);
+        REQUIRE(PropertyConstraint::parse("age <>", constraint) == false);
+        REQUIRE(PropertyConstraint{"age", PropertyConstraint::LESS, "100"}.matches(data.access("a1")) == true);
+        REQUIRE(PropertyConstraint{"age", PropertyConstraint::LESS, "abc"}.matches(data.access("a1")) == false);
+        REQUIRE(PropertyConstraint{"age", PropertyConstraint::EQUAL, "50.0"}.matches(data.access("a1")) == true);
+        REQUIRE(PropertyConstraint{"age", PropertyConstraint::EXISTS, ""}.matches(data.access("b1")) == false);
+        const PropertyConstraints constraints(propertyConstraintsOf(query));
+        REQUIRE(constraints.size() == 1);
+        REQUIRE(constraints.at("x").size() == 1);
+        const CandidateIndex index(data);
+        const CandidateIndex propertyIndex(data, {"age"});
+        REQUIRE(propertyIndex.indexed("age") == true);
+        REQUIRE(index.indexed("age") == false);
+        REQUIRE(propertyIndex.candidates(data, query, "x", constraints.at("x")) == Hyperedges{"a1", "a3"});
+        REQUIRE(index.candidates(data, query, "x", constraints.at("x")) == Hyperedges{"a1", "a3"});
+        REQUIRE(propertyIndex.candidates(data, query, "x", {{"age", PropertyConstraint::LESS_EQUAL, "45"}, {"age", PropertyConstraint::NOT_EQUAL, "20"}}) == Hyperedges{"a3"});
+        REQUIRE(propertyIndex.candidates(data, query, "z", {{"age", PropertyConstraint::EQUAL, "45"}}) == Hyperedges{"a3"});
+        std::vector< Mapping > constrained;
+        data.matchParallel(query, propertyIndex.matchFunc(query, constraints), [&](const Mapping& m) -> bool { constrained.push_back(m); return true; }, 1);
+        REQUIRE(constrained.size() == 1);
+        REQUIRE(constrained.front().find("x")->second == "a1");
+    }
+    SECTION("Compiled patterns")
+    {
+        // Compiled patterns can be matched repeatedly and stored
+        const Hypergraph data(patternData());
+        const Hypergraph query(patternQuery());
+        const CompiledPattern pattern(query);
+        REQUIRE(pattern.valid() == true);
+        REQUIRE(pattern.order().size() == 4);
+        std::vector< Mapping > compiled;
+        REQUIRE(data.matchAll(pattern, [&](const Mapping& m) -> bool { compiled.push_back(m); return true; }).matches == 2);
+        std::vector< Mapping > sorted(matchesOf(data, query));
+        std::sort(sorted.begin(), sorted.end());
+        std::sort(compiled.begin(), compiled.end());
+        REQUIRE(compiled == sorted);
+        const CompiledPattern loaded(YAML::Load(YAML::StringFrom(pattern)).as<CompiledPattern>());
+        REQUIRE(loaded.order() == pattern.order());
+        REQUIRE(loaded.constraints() == pattern.constraints());
+        REQUIRE(loaded.unmappedNeighbours() == pattern.unmappedNeighbours());
+        MatchState compiledState;
+        REQUIRE(data.match(loaded, compiledState, Hypergraph::defaultMatchFunc).size() == 4);
+        REQUIRE(data.match(loaded, compiledState, Hypergraph::defaultMatchFunc).size() == 4);
+        REQUIRE(data.match(loaded, compiledState, Hypergraph::defaultMatchFunc).empty() == true);
+        REQUIRE(CompiledPattern(query, Hyperedges{"x", "y"}).valid() == false);
+        REQUIRE(CompiledPattern(query, pattern.order()).valid() == true);
+        // Stored plans have to fit to the wiring of the query
+        std::vector< CompiledPattern::Constraints > tampered(pattern.constraints());
+        for (CompiledPattern::Constraints& constraints : tampered)
+        {
+            if (!constraints.empty())
+            {
+                constraints.pop_back();
+                break;
+            }
+        }
+        REQUIRE(CompiledPattern(query, pattern.order(), tampered, pattern.unmappedNeighbours()).valid() == false);
+        REQUIRE(CompiledPattern(query, pattern.order(), pattern.constraints(), std::vector< unsigned >(4, 0)).valid() == false);
+    }
+    SECTION("Graph statistics")
+    {
+        const Hypergraph data(patternData());
+        const Hypergraph query(patternQuery());
+        const GraphStatistics statistics(data);
+        REQUIRE(statistics.size() == 6);
+        REQUIRE(statistics.cardinality("A") == 3);
+        REQUIRE(statistics.cardinality("C") == 0);
+        REQUIRE(statistics.degreeHistogram("B", Hypergraph::FORWARD) == std::vector< unsigned >{1, 1});
+        REQUIRE(statistics.cooccurrences("A", "B") == 3);
+        REQUIRE(statistics.cooccurrences("B", "A") == 1);
+        REQUIRE(statistics.cooccurrences("", "A") == 1);
+        REQUIRE(statistics.fanout("B", "A", Hypergraph::INVERSE) == Approx(1.5));
+        REQUIRE(statistics.candidates(query, "y") == Approx(1.0));
+        // A selective hedge comes first even if its degree is low: One R points to one of many As forming a ring (every A points to the next two)
+        Hypergraph ring;
+        ring.create("r", "R");
+        for (unsigned i = 0; i < 10; i++)
+            ring.create("s" + std::to_string(i), "A");
+        ring.pointsTo(Hyperedges{"r"}, Hyperedges{"s0"});
+        for (unsigned i = 0; i < 10; i++)
+            ring.pointsTo(Hyperedges{"s" + std::to_string(i)}, Hyperedges{"s" + std::to_string((i + 1) % 10), "s" + std::to_string((i + 2) % 10)});
+        Hypergraph ringQuery;
+        ringQuery.create("r", "R");
+        ringQuery.create("u", "A");
+        ringQuery.create("v", "A");
+        ringQuery.pointsTo(Hyperedges{"r"}, Hyperedges{"u"});
+        ringQuery.pointsTo(Hyperedges{"v"}, Hyperedges{"u"});
+        const CompiledPattern plain(ringQuery);
+        const CompiledPattern planned(ringQuery, GraphStatistics(ring));
+        REQUIRE(plain.order()[0] == "u");
+        REQUIRE(planned.order()[0] == "r");
+        REQUIRE(ring.matchAll(plain, [](const Mapping& m) -> bool { return true; }).matches == 2);
+        REQUIRE(ring.matchAll(planned, [](const Mapping& m) -> bool { return true; }).matches == 2);
+    }
+    SECTION("Multi patterns")
+    {
+        // x:A -> y:B is shared by both queries
+        const Hypergraph data(patternData());
+        const Hypergraph query(patternQuery());
+        Hypergraph shorter;
+        shorter.create("x", "A");
+        shorter.create("y", "B");
+        shorter.pointsTo(Hyperedges{"x"}, Hyperedges{"y"});
+        const MultiPattern multi({query, shorter});
+        REQUIRE(multi.size() == 2);
+        REQUIRE(multi.positions() == 5);
+        REQUIRE(multi.separatePositions() == 7);
+        std::vector< std::set< Mapping > > multiMatches(2);
+        const MultiMatchSummary multiSummary(multi.matchAll(data, [&](const unsigned q, const Mapping& m) -> bool { multiMatches[q].insert(m); return true; }));
+        REQUIRE(multiSummary.complete == true);
+        REQUIRE(multiSummary.matches == std::vector< unsigned long long >{2, 3});
+        const std::vector< Mapping >& sequential(matchesOf(data, query));
+        REQUIRE(multiMatches[0] == std::set< Mapping >(sequential.begin(), sequential.end()));
+        REQUIRE(multiSummary.extensions < multiSummary.separateExtensions);
+        MatchOptions options;
+        options.maxResults = 1;
+        REQUIRE(multi.matchAll(data, [](const unsigned q, const Mapping& m) -> bool { return true; }, options).complete == false);
+    }
+    SECTION("Standing queries")
+    {
+        // x:A -> y:B
+        Hypergraph data;
+        data.create("a1", "A");
+        data.create("b1", "B");
+        data.pointsTo(Hyperedges{"a1"}, Hyperedges{"b1"});
+        Hypergraph query;
+        query.create("x", "A");
+        query.create("y", "B");
+        query.pointsTo(Hyperedges{"x"}, Hyperedges{"y"});
+        std::vector< Mapping > added, removed;
+        StandingQueries standing(data);
+        REQUIRE(data.log() != nullptr);
+        const unsigned q(standing.add(query, [&](const Mapping& m, const bool isNew) { (isNew ? added : removed).push_back(m); }));
+        REQUIRE(added.size() == 1);
+        REQUIRE(standing.update() == 0);
+        // A new A pointing to b1 gives a new embedding
+        data.create("a2", "A");
+        data.pointsTo(Hyperedges{"a2"}, Hyperedges{"b1"});
+        REQUIRE(standing.pending().size() == 2);
+        REQUIRE(standing.update() == 1);
+        REQUIRE(standing.pending().empty() == true);
+        REQUIRE(added.back().find("x")->second == "a2");
+        // Unrelated changes do not change anything
+        data.create("c1", "C");
+        data.pointsTo(Hyperedges{"c1"}, Hyperedges{"a2"});
+        REQUIRE(standing.update() == 0);
+        // Destroying a1 and b1 invalidates both embeddings
+        data.destroy("a1");
+        REQUIRE(standing.update() == 1);
+        REQUIRE(removed.back().find("x")->second == "a1");
+        data.destroy("b1");
+        REQUIRE(standing.update() == 1);
+        REQUIRE(removed.back().find("x")->second == "a2");
+        REQUIRE(standing.embeddings(q).empty() == true);
+        data.create("b2", "B");
+        data.pointsTo(Hyperedges{"a2", "c1"}, Hyperedges{"b2"});
+        REQUIRE(standing.update() == 1);
+        std::set< Mapping > all;
+        data.matchAll(query, [&](const Mapping& m) -> bool { all.insert(m); return true; });
+        REQUIRE(standing.embeddings(q) == all);
+        // Disconnecting leaves stale entries in the caches, which must not break the change log
+        data.create("a3", "A");
+        data.create("b3", "B");
+        data.pointsTo(Hyperedges{"a3"}, Hyperedges{"b3"});
+        data.pointsFrom(Hyperedges{"b3"}, Hyperedges{"a3"});
+        data.disconnect("b3");
+        data.destroy("a3");
+        REQUIRE_NOTHROW(data.destroy("b3"));
+        standing.update();
+        all.clear();
+        data.matchAll(query, [&](const Mapping& m) -> bool { all.insert(m); return true; });
+        REQUIRE(standing.embeddings(q) == all);
     }
-    // TODO: Test rewriting
     SECTION("Rewriting")
     {
+        // a:A -> b:B <- c:C, replace the B pointed to by an A by b:D <- n:N and delete the A
+        Hypergraph data;
+        data.create("a", "A");
+        data.create("b", "B", Properties{{"weight", "3"}});
+        data.create("c", "C");
+        data.pointsTo(Hyperedges{"a", "c"}, Hyperedges{"b"});
+        Hypergraph lhs;
+        lhs.create("x", "A");
+        lhs.create("y", "B");
+        lhs.pointsTo(Hyperedges{"x"}, Hyperedges{"y"});
+        Hypergraph rhs;
+        rhs.create("y2", "D");
+        rhs.create("n", "N");
+        rhs.pointsTo(Hyperedges{"n"}, Hyperedges{"y2"});
+        const Mapping partialMap{{"y", "y2"}};
+        MatchState state;
+        const Mapping& m(data.match(lhs, state, Hypergraph::defaultMatchFunc));
+        REQUIRE(m.find("y")->second == "b");
+        const Hypergraph& copied(data.rewrite(m, rhs, partialMap));
+        ChangeLog changes;
+        data.record(&changes);
+        REQUIRE(data.rewriteInPlace(m, rhs, partialMap) == Hyperedges{"b", "n"});
+        REQUIRE(changes.empty() == false);
+        data.record(nullptr);
+        // Same result as the copying rewrite, but the properties of b are kept
+        REQUIRE(data.exists("a") == false);
+        REQUIRE(data.access("b").label() == "D");
+        REQUIRE(data.access("b").property("weight") == "3");
+        REQUIRE(data.isPointingTo(Hyperedges{"b"}).empty() == true);
+        REQUIRE(data.access("c").isPointingTo("b") == true);
+        REQUIRE(data.access("n").isPointingTo("b") == true);
+        Hyperedges expected(copied.findByLabel());
+        Hyperedges actual(data.findByLabel());
+        std::sort(expected.begin(), expected.end());
+        std::sort(actual.begin(), actual.end());
+        REQUIRE(actual == expected);
+        for (const UniqueId& id : actual)
+        {
+            REQUIRE(data.access(id).label() == copied.access(id).label());
+            REQUIRE(data.isPointingTo(Hyperedges{id}) == copied.isPointingTo(Hyperedges{id}));
+        }
+        // No match, nothing to do
+        REQUIRE(data.rewriteInPlace(lhs, rhs, partialMap, Hypergraph::defaultMatchFunc).empty() == true);
+    }
+    SECTION("Rewrite engine")
+    {
+        // A chain a <- r1 -> b <- r2 -> c of concepts (C) related by relations (R)
+        Hypergraph data;
+        for (const UniqueId& id : Hyperedges{"a", "b", "c"})
+            data.create(id, "Old");
+        data.create("r1", "R");
+        data.create("r2", "R");
+        data.pointsFrom(Hyperedges{"r1"}, Hyperedges{"a"});
+        data.pointsTo(Hyperedges{"r1"}, Hyperedges{"b"});
+        data.pointsFrom(Hyperedges{"r2"}, Hyperedges{"b"});
+        data.pointsTo(Hyperedges{"r2"}, Hyperedges{"c"});
+        // Rule 1: Relabel Old to C
+        RewriteRule relabel;
+        relabel.lhs.create("x", "Old");
+        relabel.rhs.create("x", "C");
+        relabel.partialMap = Mapping{{"x", "x"}};
+        // Rule 2: Add the transitive relation x <- r3 -> z
+        RewriteRule transitive;
+        for (const UniqueId& id : Hyperedges{"x", "y", "z"})
+        {
+            transitive.lhs.create(id, "C");
+            transitive.rhs.create(id, "C");
+            transitive.partialMap.insert({id, id});
+        }
+        for (const UniqueId& id : Hyperedges{"r1", "r2"})
+        {
+            transitive.lhs.create(id, "R");
+            transitive.rhs.create(id, "R");
+            transitive.partialMap.insert({id, id});
+        }
+        transitive.rhs.create("r3", "R");
+        for (Hypergraph* graph : std::vector< Hypergraph* >{&transitive.lhs, &transitive.rhs})
+        {
+            graph->pointsFrom(Hyperedges{"r1"}, Hyperedges{"x"});
+            graph->pointsTo(Hyperedges{"r1"}, Hyperedges{"y"});
+            graph->pointsFrom(Hyperedges{"r2"}, Hyperedges{"y"});
+            graph->pointsTo(Hyperedges{"r2"}, Hyperedges{"z"});
+        }
+        transitive.rhs.pointsFrom(Hyperedges{"r3"}, Hyperedges{"x"});
+        transitive.rhs.pointsTo(Hyperedges{"r3"}, Hyperedges{"z"});
+        const RewriteEngine engine(std::vector< RewriteRule >{relabel, transitive});
+        REQUIRE(engine.radius(0) == 0);
+        REQUIRE(engine.radius(1) == 4);
+
+        // Stop early
+        Hypergraph limited(data);
+        RewriteOptions options;
+        options.maxFirings = 1;
+        RewriteSummary summary(engine.run(limited, options));
+        REQUIRE(summary.total == 1);
+        REQUIRE(summary.fixpoint == false);
+
+        // Run until fixpoint: All relabelings fire in the first round, the transitive relation in the second
+        ChangeLog changes;
+        data.record(&changes);
+        summary = engine.run(data);
+        REQUIRE(summary.fixpoint == true);
+        REQUIRE(summary.firings == std::vector< unsigned long long >{3, 1});
+        REQUIRE(summary.total == 4);
+        REQUIRE(summary.rounds == 3);
+        REQUIRE(summary.firingsPerSecond() > 0.0);
+        REQUIRE(data.log() == &changes);
+        REQUIRE(changes.empty() == false);
+        data.record(nullptr);
+        REQUIRE(data.findByLabel("Old").empty() == true);
+        REQUIRE(data.findByLabel("C").size() == 3);
+        // The new relation got a fresh id
+        const Hyperedges& relations(data.findByLabel("R"));
+        REQUIRE(relations.size() == 3);
+        REQUIRE(data.exists("r3") == false);
+        for (const UniqueId& id : relations)
+        {
+            if ((id == "r1") || (id == "r2"))
+                continue;
+            REQUIRE(data.access(id).isPointingFrom("a") == true);
+            REQUIRE(data.access(id).isPointingTo("c") == true);
+        }
+
+        // Graphs with stale cache entries (disconnect, then destroy) can be rewritten as well
+        Hypergraph stale;
+        stale.create("a", "X");
+        stale.create("b", "Y");
+        stale.pointsTo(Hyperedges{"a"}, Hyperedges{"b"});
+        stale.disconnect("b");
+        stale.destroy("a");
+        RewriteRule rename;
+        rename.lhs.create("y", "Y");
+        rename.rhs.create("y", "Z");
+        rename.partialMap = Mapping{{"y", "y"}};
+        REQUIRE_NOTHROW(summary = RewriteEngine(std::vector< RewriteRule >{rename}).run(stale));
+        REQUIRE(summary.total == 1);
+        REQUIRE(stale.access("b").label() == "Z");
+
+        // A batched match can be invalidated by applying another one: Splitting s creates the hedge sq,
+        // so the lhs hedge sq of the second rule cannot be matched to v anymore (only to sq itself in the next round)
+        Hypergraph split;
+        split.create("s", "S");
+        split.create("v", "V");
+        RewriteRule splitter;
+        splitter.lhs.create("x", "S");
+        splitter.rhs.create("p", "S");
+        splitter.rhs.create("q", "T");
+        splitter.partialMap = Mapping{{"x", "p"}, {"x", "q"}};
+        RewriteRule relabelV;
+        relabelV.lhs.create("sq", "V");
+        relabelV.rhs.create("sq", "W");
+        relabelV.partialMap = Mapping{{"sq", "sq"}};
+        summary = RewriteEngine(std::vector< RewriteRule >{splitter, relabelV}).run(split);
+        REQUIRE(split.exists("sq") == true);
+        REQUIRE(split.access("sq").label() == "W");
+        REQUIRE(split.access("v").label() == "V");
+        REQUIRE(summary.firings == std::vector< unsigned long long >{1, 1});
+        REQUIRE(summary.conflicts == 1);
     }
     SECTION("Serialize & Reconstruct")
     {
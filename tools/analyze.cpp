@@ -0,0 +1,130 @@
+#include "Hypergraph.hpp"
+#include "HypergraphYAML.hpp"
+#include "CompactHypergraph.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cassert>
+#include <cstdlib>
+#include <getopt.h>
+#include <chrono>
+#include <algorithm>
+
+static struct option long_options[] = {
+    {"help", no_argument, 0, 'h'},
+    {"threads", required_argument, 0, 't'},
+    {"top", required_argument, 0, 'n'},
+    {0,0,0,0}
+};
+
+void usage (const char *myName)
+{
+    std::cout << "Compute some statistics & rankings of a hypergraph\n";
+    std::cout << "Usage:\n";
+    std::cout << myName << " <yaml-file-in>\n\n";
+    std::cout << "Options:\n";
+    std::cout << "--help\t\t" << "Show usage\n";
+    std::cout << "--threads <N>\t" << "Use N threads (default: all cores)\n";
+    std::cout << "--top <K>\t" << "Show the K highest ranked hedges (default: 10)\n";
+    std::cout << "\nExample:\n";
+    std::cout << myName << " --threads 4 datagraph.yml\n";
+}
+
+// Returns the milliseconds passed since start
+static long long millisecondsSince(const std::chrono::system_clock::time_point& start)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - start).count();
+}
+
+static void printHistogram(const std::string& name, const std::vector< unsigned >& histogram)
+{
+    unsigned long long total = 0;
+    unsigned long long sum = 0;
+    for (unsigned d = 0; d < histogram.size(); d++)
+    {
+        total += histogram[d];
+        sum += (unsigned long long)d * histogram[d];
+    }
+    std::cout << name << ": max " << (histogram.empty() ? 0 : histogram.size() - 1);
+    std::cout << " mean " << (total ? (double)sum / total : 0.0) << "\n";
+}
+
+int main (int argc, char **argv)
+{
+    unsigned threads = 0;
+    unsigned top = 10;
+
+    // Parse command line
+    int c;
+    while (1)
+    {
+        int option_index = 0;
+        c = getopt_long(argc, argv, "ht:n:", long_options, &option_index);
+        if (c == -1)
+            break;
+
+        switch (c)
+        {
+            case 't':
+                threads = std::atoi(optarg);
+                break;
+            case 'n':
+                top = std::atoi(optarg);
+                break;
+            case 'h':
+            case '?':
+                break;
+            default:
+                std::cout << "W00t?!\n";
+                return 1;
+        }
+    }
+
+    if ((argc - optind) < 1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    const std::string& fileNameIn(argv[optind]);
+
+    // Load graph
+    Hypergraph graph(YAML::LoadFile(fileNameIn).as<Hypergraph>());
+
+    auto start = std::chrono::system_clock::now();
+    const CompactHypergraph compact(graph);
+    std::cout << "Snapshot of " << compact.size() << " hedges in " << millisecondsSince(start) << " ms\n";
+
+    start = std::chrono::system_clock::now();
+    printHistogram("Outdegree", compact.degreeHistogram(Hypergraph::FORWARD, threads));
+    printHistogram("Indegree", compact.degreeHistogram(Hypergraph::INVERSE, threads));
+    printHistogram("Degree", compact.degreeHistogram(Hypergraph::BOTH, threads));
+    std::cout << "Degree histograms in " << millisecondsSince(start) << " ms\n";
+
+    start = std::chrono::system_clock::now();
+    const std::vector< double >& rank(compact.pageRank(0.85, 100, 1e-9, threads));
+    std::cout << "PageRank in " << millisecondsSince(start) << " ms\n";
+    std::vector< Handle > ranked(compact.size());
+    for (Handle h = 0; h < compact.size(); h++)
+        ranked[h] = h;
+    std::sort(ranked.begin(), ranked.end(), [&](const Handle a, const Handle b) -> bool { return rank[a] > rank[b]; });
+    for (unsigned i = 0; i < std::min<unsigned>(top, ranked.size()); i++)
+    {
+        std::cout << "\t" << rank[ranked[i]] << "\t" << compact.id(ranked[i]) << ":" << compact.labelName(compact.label(ranked[i])) << "\n";
+    }
+
+    start = std::chrono::system_clock::now();
+    const std::vector< unsigned >& cores(compact.coreNumbers());
+    std::cout << "Core numbers in " << millisecondsSince(start) << " ms\n";
+    unsigned maxCore = 0;
+    for (const unsigned core : cores)
+        maxCore = std::max(maxCore, core);
+    std::cout << "Degeneracy (max core): " << maxCore << "\n";
+
+    start = std::chrono::system_clock::now();
+    const std::vector< unsigned >& components(compact.labelPropagationComponents(threads));
+    const unsigned noComponents(components.empty() ? 0 : *std::max_element(components.begin(), components.end()) + 1);
+    std::cout << "Found " << noComponents << " weakly connected components in " << millisecondsSince(start) << " ms\n";
+
+    return 0;
+}
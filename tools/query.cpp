@@ -1,16 +1,29 @@
 #include "Hypergraph.hpp"
 #include "HypergraphYAML.hpp"
+#include "CandidateIndex.hpp"
+#include "GraphStatistics.hpp"
 
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <cassert>
+#include <cstdlib>
 #include <getopt.h>
 #include <chrono>
 
 static struct option long_options[] = {
     {"help", no_argument, 0, 'h'},
     {"all", no_argument, 0, 'a'},
+    {"engine", required_argument, 0, 'e'},
+    {"max", required_argument, 0, 'm'},
+    {"timeout", required_argument, 0, 'b'},
+    {"count", no_argument, 0, 'c'},
+    {"threads", required_argument, 0, 't'},
+    {"compile", required_argument, 0, 'p'},
+    {"stats", no_argument, 0, 's'},
+    {"distinct", no_argument, 0, 'd'},
+    {"expand", no_argument, 0, 'x'},
+    {"index", required_argument, 0, 'i'},
     {0,0,0,0}
 };
 
@@ -22,13 +35,32 @@ void usage (const char *myName)
     std::cout << "Options:\n";
     std::cout << "--help\t" << "Show usage\n";
     std::cout << "--all\t" << "Finds all occurrences of query graph in data graph\n";
+    std::cout << "--engine <ullmann|vf2>\t" << "Selects the matching algorithm (default: ullmann)\n";
+    std::cout << "The ullmann engine only looks up a single match. The following options (and --all) always use the vf2 engine:\n";
+    std::cout << "--max <N>\t" << "Stop after N matches (implies --all)\n";
+    std::cout << "--timeout <ms>\t" << "Stop after the given number of milliseconds\n";
+    std::cout << "--count\t" << "Only count the matches (implies --all)\n";
+    std::cout << "--threads <N>\t" << "Use N threads (default: 1, 0: all cores)\n";
+    std::cout << "--compile <yaml-file-out>\t" << "Stores the compiled query graph, which can be used instead of the query graph later on\n";
+    std::cout << "--stats\t" << "Plans the search using statistics of the data graph\n";
+    std::cout << "--distinct\t" << "Finds every embedding only once (instead of once per automorphism of the query graph)\n";
+    std::cout << "--expand\t" << "Like --distinct, but prints all automorphic variants of each embedding\n";
+    std::cout << "--index <key>\t" << "Indexes the property key of the data graph (can be given multiple times)\n";
+    std::cout << "\nQuery hedges can constrain properties of their matches by a property 'where', e.g. where: \"age > 40; name\"\n";
     std::cout << "\nExample:\n";
     std::cout << myName << " datagraph.yml querygraph.yml\n";
+    std::cout << myName << " --engine vf2 --compile querypattern.yml datagraph.yml querygraph.yml\n";
+    std::cout << myName << " --engine vf2 --all datagraph.yml querypattern.yml\n";
 }
 
 int main (int argc, char **argv)
 {
     bool find_all = false;
+    Hypergraph::MatchEngine engine = Hypergraph::ULLMANN;
+    MatchOptions options;
+    std::string fileNameOut;
+    bool useStatistics = false;
+    std::vector< std::string > indexedKeys;
 
     std::cout << "Query a data hypergraph using a query hypergraph and subgraph isomorphism algorithm\n";
 
@@ -37,7 +69,7 @@ int main (int argc, char **argv)
     while (1)
     {
         int option_index = 0;
-        c = getopt_long(argc, argv, "h", long_options, &option_index);
+        c = getopt_long(argc, argv, "hae:m:b:ct:p:sdxi:", long_options, &option_index);
         if (c == -1)
             break;
 
@@ -46,6 +78,47 @@ int main (int argc, char **argv)
             case 'a':
                 find_all = true;
                 break;
+            case 'e':
+                if (std::string(optarg) == "vf2")
+                {
+                    engine = Hypergraph::VF2;
+                } else if (std::string(optarg) == "ullmann") {
+                    engine = Hypergraph::ULLMANN;
+                } else {
+                    std::cout << "Unknown engine " << optarg << "\n";
+                    return -1;
+                }
+                break;
+            case 'm':
+                options.maxResults = std::atoll(optarg);
+                find_all = true;
+                break;
+            case 'b':
+                options.timeBudget = std::atoi(optarg);
+                break;
+            case 'c':
+                options.countOnly = true;
+                find_all = true;
+                break;
+            case 't':
+                options.threads = std::atoi(optarg);
+                break;
+            case 'p':
+                fileNameOut = optarg;
+                break;
+            case 'd':
+                options.symmetryBreaking = true;
+                break;
+            case 'x':
+                options.symmetryBreaking = true;
+                options.expandSymmetries = true;
+                break;
+            case 's':
+                useStatistics = true;
+                break;
+            case 'i':
+                indexedKeys.push_back(optarg);
+                break;
             case 'h':
             case '?':
                 break;
@@ -65,32 +138,71 @@ int main (int argc, char **argv)
 
     // Load graph
     Hypergraph datagraph(YAML::LoadFile(fileNameIn).as<Hypergraph>());
-    Hypergraph querygraph(YAML::LoadFile(fileNameIn2).as<Hypergraph>());
-
-    // Find matching(s)
-    std::cout << "Searching ...\n";
-    unsigned int no_matches = 0;
-    std::stack< Mapping > searchSpace;
-    auto start = std::chrono::system_clock::now();
-    Mapping mapping(datagraph.match(querygraph, searchSpace, Hypergraph::defaultMatchFunc));
-
-    if (!mapping.size())
+    // NOTE: The query can be given as a hypergraph or as a compiled pattern
+    const YAML::Node& queryNode(YAML::LoadFile(fileNameIn2));
+    const bool compiled(queryNode.IsMap());
+    CompiledPattern pattern(compiled ? queryNode.as<CompiledPattern>() : CompiledPattern());
+    Hypergraph querygraph(compiled ? pattern.query() : queryNode.as<Hypergraph>());
+    if (useStatistics && !compiled)
     {
-        std::cout << "No match found\n";
-        return 0;
+        auto start = std::chrono::system_clock::now();
+        pattern = CompiledPattern(querygraph, GraphStatistics(datagraph));
+        std::cout << "Planned search using statistics in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - start).count() << " ms\n";
     }
-    no_matches++;
-
-    // Dump first match
-    for (const auto &pair : mapping)
+    if (!fileNameOut.empty())
     {
-        std::cout << querygraph.access(pair.first) << " -> " << datagraph.access(pair.second) << "\n";
+        if (!compiled && !useStatistics)
+            pattern = CompiledPattern(querygraph);
+        std::ofstream fout;
+        fout.open(fileNameOut);
+        if (fout.good())
+            fout << YAML::StringFrom(pattern) << std::endl;
+        else
+            std::cout << "FAILED to store compiled pattern\n";
+        fout.close();
     }
+    const bool usePattern(compiled || useStatistics || !fileNameOut.empty());
 
-    // Dump other matches if desired
-    if (find_all)
+    // Index the data graph
+    auto start = std::chrono::system_clock::now();
+    const CandidateIndex index(datagraph, indexedKeys);
+    const PropertyConstraints constraints(propertyConstraintsOf(querygraph));
+    const CandidateIndex::MatchFunc matchFunc(index.matchFunc(querygraph, constraints));
+    std::cout << "Indexed " << index.data().size() << " hedges in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - start).count() << " ms\n";
+
+    // Find matching(s)
+    const bool vf2Only(find_all || options.timeBudget || (options.threads != 1) || options.symmetryBreaking || usePattern);
+    if ((engine == Hypergraph::ULLMANN) && vf2Only)
+    {
+        std::cout << "Using the vf2 engine (the ullmann engine only looks up a single match)\n";
+        engine = Hypergraph::VF2;
+    }
+    std::cout << "Searching ...\n";
+    unsigned long long no_matches = 0;
+    bool complete = true;
+    start = std::chrono::system_clock::now();
+    if (engine == Hypergraph::VF2)
     {
-        while ((mapping = datagraph.match(querygraph, searchSpace, Hypergraph::defaultMatchFunc)).size())
+        // Stream the matches to the console
+        if (!find_all)
+            options.maxResults = 1;
+        auto print = [&](const Mapping& mapping) -> bool {
+            std::cout << "\n";
+            for (const auto &pair : mapping)
+            {
+                std::cout << querygraph.access(pair.first) << " -> " << datagraph.access(pair.second) << "\n";
+            }
+            return true;
+        };
+        MatchSummary summary(usePattern ? datagraph.matchAll(pattern, print, options, matchFunc) : datagraph.matchAll(querygraph, print, options, matchFunc));
+        no_matches = summary.matches;
+        complete = summary.complete;
+    } else {
+        MatchState state(engine);
+        const Mapping& mapping(datagraph.match(querygraph, state, matchFunc));
+        if (mapping.size())
         {
             std::cout << "\n";
             for (const auto &pair : mapping)
@@ -101,9 +213,27 @@ int main (int argc, char **argv)
         }
     }
     auto end = std::chrono::system_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
 
-    std::cout << "\nFound " << no_matches << " matches in " << elapsed.count() << " ms\n";
+    if (!no_matches)
+    {
+        std::cout << "No match found\n";
+        return 0;
+    }
+    std::cout << "\nFound " << no_matches << " matches in " << elapsed.count() / 1000.0 << " ms";
+    if (find_all)
+    {
+        std::cout << " (";
+        if (elapsed.count())
+            std::cout << no_matches * 1000000.0 / elapsed.count();
+        else
+            std::cout << "n/a";
+        std::cout << " matches/s";
+        if (!complete)
+            std::cout << ", stopped early";
+        std::cout << ")";
+    }
+    std::cout << "\n";
 
     return no_matches;
 }
@@ -0,0 +1,114 @@
+#include "Hypergraph.hpp"
+#include "HypergraphYAML.hpp"
+#include "RewriteEngine.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <getopt.h>
+
+static struct option long_options[] = {
+    {"help", no_argument, 0, 'h'},
+    {"max", required_argument, 0, 'm'},
+    {"timeout", required_argument, 0, 'b'},
+    {"threads", required_argument, 0, 't'},
+    {0,0,0,0}
+};
+
+void usage (const char *myName)
+{
+    std::cout << "Rewrite a hypergraph using a set of rules until no rule matches anymore\n";
+    std::cout << "Usage:\n";
+    std::cout << myName << " <yaml-file-in> <yaml-file-out> <lhs-yaml-file> <rhs-yaml-file> [<lhs-yaml-file> <rhs-yaml-file> ...]\n\n";
+    std::cout << "Every pair of lhs and rhs graphs forms a rule. Hedges of lhs are mapped to the hedges of rhs with the same id.\n";
+    std::cout << "Hedges of lhs without such a partner get deleted, hedges of rhs without such a partner get created.\n";
+    std::cout << "Rules given first take precedence.\n\n";
+    std::cout << "Options:\n";
+    std::cout << "--help\t" << "Show usage\n";
+    std::cout << "--max <N>\t" << "Stop after N rule firings\n";
+    std::cout << "--timeout <ms>\t" << "Stop after the given number of milliseconds\n";
+    std::cout << "--threads <N>\t" << "Match the rules using N threads (default: 1, 0: all cores)\n";
+    std::cout << "\nExample:\n";
+    std::cout << myName << " ontology.yml normalized.yml lhs1.yml rhs1.yml lhs2.yml rhs2.yml\n";
+}
+
+int main (int argc, char **argv)
+{
+    RewriteOptions options;
+
+    // Parse command line
+    int c;
+    while (1)
+    {
+        int option_index = 0;
+        c = getopt_long(argc, argv, "hm:b:t:", long_options, &option_index);
+        if (c == -1)
+            break;
+
+        switch (c)
+        {
+            case 'm':
+                options.maxFirings = std::atoll(optarg);
+                break;
+            case 'b':
+                options.timeBudget = std::atoi(optarg);
+                break;
+            case 't':
+                options.threads = std::atoi(optarg);
+                break;
+            case 'h':
+            case '?':
+                break;
+            default:
+                std::cout << "W00t?!\n";
+                return 1;
+        }
+    }
+
+    if (((argc - optind) < 4) || ((argc - optind) % 2))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    const std::string fileNameIn(argv[optind]);
+    const std::string fileNameOut(argv[optind+1]);
+
+    // Load graph and rules
+    Hypergraph datagraph(YAML::LoadFile(fileNameIn).as<Hypergraph>());
+    std::vector< RewriteRule > rules;
+    for (int i = optind + 2; i < argc; i += 2)
+    {
+        RewriteRule rule;
+        rule.name = std::string(argv[i]) + " -> " + argv[i+1];
+        rule.lhs = YAML::LoadFile(argv[i]).as<Hypergraph>();
+        rule.rhs = YAML::LoadFile(argv[i+1]).as<Hypergraph>();
+        for (const UniqueId& id : rule.lhs.findByLabel())
+        {
+            if ((id != Hypergraph::Zero) && rule.rhs.exists(id))
+                rule.partialMap.insert({id, id});
+        }
+        rules.push_back(rule);
+    }
+
+    // Rewrite
+    const RewriteEngine engine(rules);
+    const RewriteSummary summary(engine.run(datagraph, options));
+    for (unsigned r = 0; r < engine.size(); r++)
+        std::cout << engine.rule(r).name << ": " << summary.firings[r] << " firings\n";
+    std::cout << "\n" << summary.total << " firings in " << summary.rounds << " rounds and " << summary.seconds * 1000.0 << " ms ("
+              << summary.firingsPerSecond() << " firings/s, " << summary.conflicts << " overlapping matches postponed)\n";
+    if (!summary.fixpoint)
+        std::cout << "Stopped before reaching a fixpoint\n";
+
+    // Store graph
+    std::ofstream fout;
+    fout.open(fileNameOut);
+    if (fout.good()) {
+        fout << YAML::StringFrom(datagraph) << std::endl;
+    } else {
+        std::cout << "FAILED\n";
+    }
+    fout.close();
+
+    return 0;
+}